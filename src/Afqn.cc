@@ -0,0 +1,157 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "Afqn.h"
+#include "Engine.h"
+
+#include <new>
+
+
+struct afqn_engine {
+    AfqnEngine engine;
+};
+
+
+const char *afqn_version(void) {
+    return VERSION;
+}
+
+
+afqn_engine *afqn_create(int s, int sketch_bound, double alpha, int diff_fraction, int uniform) {
+
+    afqn_engine *handle = new (std::nothrow) afqn_engine;
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    if (sketch_bound <= 0) {
+        sketch_bound = 2*s;
+    }
+    if (initEngine(&handle->engine, s, sketch_bound, alpha, diff_fraction, uniform ? UNIFORM_SELECTION : NEAREST_SELECTION)) {
+        delete handle;
+        return NULL;
+    }
+    return handle;
+}
+
+
+void afqn_destroy(afqn_engine *handle) {
+
+    if (handle != NULL) {
+        destroyEngine(&handle->engine);
+        delete handle;
+    }
+}
+
+
+long afqn_process(afqn_engine *handle, const double *values, long n,
+                  long *seq, double *middle, double *median, double *qn,
+                  int *outlier, int *collapses, double *alpha, int *bins) {
+
+    AfqnEngine *engine = &handle->engine;
+
+    long i = 0;
+    for (; i < n && engine->count < engine->s; ++i) {
+        fillEngine(engine, (Value)values[i]);
+    }//for warm-up
+
+    long written = 0;
+    Item result;
+    for (; i < n; ++i) {
+
+        engine->slide(engine, (Value)values[i]);
+        estimateEngine(engine);
+        getEngineResult(engine, &result);
+
+        if (seq)        seq[written] = result.seq;
+        if (middle)     middle[written] = result.middle;
+        if (median)     median[written] = result.median;
+        if (qn)         qn[written] = result.Qn;
+        if (outlier)    outlier[written] = result.isOutlier;
+        if (collapses)  collapses[written] = result.collapses;
+        if (alpha)      alpha[written] = result.alpha;
+        if (bins)       bins[written] = result.bins;
+        publishEngineResult(engine, &result);
+        ++written;
+    }//for
+    return written;
+}
+
+
+long afqn_count(const afqn_engine *handle) {
+    return handle->engine.count;
+}
+
+
+int afqn_publish(afqn_engine *handle, int every) {
+    return setEnginePublisher(&handle->engine, every) ? -1 : 0;
+}
+
+
+int afqn_latest(const afqn_engine *handle, long *seq, double *middle, double *median, double *qn,
+                int *outlier, int *collapses, double *alpha, int *bins) {
+
+    Item result;
+    const Publisher *pub = handle->engine.publisher;
+    if (pub == NULL || !readResult(pub, &result)) {
+        return 0;
+    }
+
+    if (seq)        *seq = result.seq;
+    if (middle)     *middle = result.middle;
+    if (median)     *median = result.median;
+    if (qn)         *qn = result.Qn;
+    if (outlier)    *outlier = result.isOutlier;
+    if (collapses)  *collapses = result.collapses;
+    if (alpha)      *alpha = result.alpha;
+    if (bins)       *bins = result.bins;
+    return 1;
+}
+
+
+void afqn_request_sketch(afqn_engine *handle) {
+
+    if (handle->engine.publisher != NULL) {
+        requestSketch(handle->engine.publisher);
+    }
+}
+
+
+int afqn_sketch(const afqn_engine *handle, double *values, long *counts, int capacity,
+                long *seq, long *version) {
+
+    const Publisher *pub = handle->engine.publisher;
+    if (pub == NULL) {
+        return 0;
+    }
+
+    SketchCopy copy;
+    copy.capacity = capacity;
+    copy.values = values;
+    copy.counts = counts;
+    long copies = readSketch(pub, &copy);
+    if (version) {
+        *version = copies;
+    }
+    if (copies == 0) {
+        return 0;
+    }
+    if (seq) {
+        *seq = copy.seq;
+    }
+    return copy.bins;
+}
@@ -0,0 +1,85 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __AFQN_H__
+#define __AFQN_H__
+
+// C interface of libafqn.so (make lib): the engine of Engine.h behind an opaque handle.
+// Engines are independent, so different threads may use different engines; one engine
+// must be used by one thread at a time, except for the readers of its published results.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+    #define AFQN_API __attribute__((visibility("default")))
+#else
+    #define AFQN_API
+#endif
+
+typedef struct afqn_engine afqn_engine;
+
+
+// Version string of the library
+AFQN_API const char *afqn_version(void);
+
+// Window of s items (s >= 3), sketch bound (0 for 2s), initial alpha in [1e-6, 1);
+// diff_fraction and uniform are those of -t and -u (1 and 0 for the full update).
+// Returns NULL on an invalid configuration.
+AFQN_API afqn_engine *afqn_create(int s, int sketch_bound, double alpha, int diff_fraction, int uniform);
+
+AFQN_API void afqn_destroy(afqn_engine *engine);
+
+// Pushes values[0..n) and writes one result per item once the window is full, for the
+// item in the middle of the window, at index i of the output arrays for its i-th result.
+// The output arrays, any of which may be NULL, must hold n entries; returns the number
+// of results written, n less the items still filling the window.
+AFQN_API long afqn_process(afqn_engine *engine, const double *values, long n,
+                           long *seq, double *middle, double *median, double *qn,
+                           int *outlier, int *collapses, double *alpha, int *bins);
+
+// Items pushed so far
+AFQN_API long afqn_count(const afqn_engine *engine);
+
+
+// Publishes the result of one item in every `every` processed (0 stops), for threads
+// reading it with afqn_latest() and afqn_sketch() while another runs afqn_process().
+// Readers never block the processing thread and never see a mix of two results.
+// Must be called before the readers start. Returns 0, or -1 if every < 0.
+AFQN_API int afqn_publish(afqn_engine *engine, int every);
+
+// Latest published result, into the pointers that are not NULL; returns 1, or 0 if
+// nothing was published yet
+AFQN_API int afqn_latest(const afqn_engine *engine, long *seq, double *middle, double *median, double *qn,
+                         int *outlier, int *collapses, double *alpha, int *bins);
+
+// Asks for a copy of the sketch along with the next published result
+AFQN_API void afqn_request_sketch(afqn_engine *engine);
+
+// Latest copy of the sketch: the value (ascending, 0 for null differences) and count of
+// its buckets, up to capacity of them (the sketch bound holds them all), and the seq of
+// the result it was taken with. Returns the number of buckets written, 0 if no copy was
+// published yet; version, if not NULL, receives the number of copies published so far.
+AFQN_API int afqn_sketch(const afqn_engine *engine, double *values, long *counts, int capacity,
+                         long *seq, long *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__AFQN_H__
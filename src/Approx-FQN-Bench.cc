@@ -0,0 +1,125 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "StreamPool.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+
+// Scaling of the stream pool: the same interleaved updates pushed with 1, 2, 4, ... threads
+
+
+static void printBenchUsage(const char *name) {
+
+    fprintf(stderr, "Usage: %s -p max_threads -k streams -s window_size -n updates -b sketch_bound -a alpha [-c capacity] [-g batch]\n", name);
+    fprintf(stderr, "Pushes n updates of normal items to uniformly drawn streams, for 1, 2, 4, ... up to max_threads threads\n");
+    fprintf(stderr, "and prints threads,streams,s,updates,seconds,updates/s,speedup,same (results equal to those of one thread)\n");
+}
+
+
+static bool sameResults(const Item *a, const Item *b, long n) {
+
+    for (long i = 0; i < n; ++i) {
+        if (a[i].seq != b[i].seq || a[i].Qn != b[i].Qn || a[i].median != b[i].median || a[i].isOutlier != b[i].isOutlier) {
+            return false;
+        }
+    }//for
+    return true;
+}
+
+
+int main(int argc, char *argv[]) {
+
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    int streams = 100000;
+    int s = 31;
+    long n = 10000000;
+    int sketchBound = 200;
+    double alpha = 0.01;
+    int capacity = 512;
+    long batch = 1 << 20;
+
+    int c;
+    while ((c = getopt(argc, argv, "p:k:s:n:b:a:c:g:h")) != -1) {
+        switch (c) {
+            case 'p': maxThreads = atoi(optarg); break;
+            case 'k': streams = atoi(optarg); break;
+            case 's': s = atoi(optarg); break;
+            case 'n': n = strtol(optarg, NULL, 10); break;
+            case 'b': sketchBound = atoi(optarg); break;
+            case 'a': alpha = strtod(optarg, NULL); break;
+            case 'c': capacity = atoi(optarg); break;
+            case 'g': batch = strtol(optarg, NULL, 10); break;
+            default:
+                printBenchUsage(argv[0]);
+                return 1;
+        }//switch
+    }//wend getopt()
+
+    if (maxThreads < 1 || n < 1) {
+        printBenchUsage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937_64 generator(1);
+    std::uniform_int_distribution<int> stream(0, streams - 1);
+    std::normal_distribution<double> normal(100.0, 15.0);
+    int *ids = (int *)allocateAligned(n*sizeof(int));
+    Value *items = (Value *)allocateAligned(n*sizeof(Value));
+    for (long i = 0; i < n; ++i) {
+        ids[i] = stream(generator);
+        items[i] = (Value)(round(normal(generator)*1000)/1000);
+    }//for
+
+    Item *reference = (Item *)allocateAligned(n*sizeof(Item));
+    Item *results = (Item *)allocateAligned(n*sizeof(Item));
+    double base = 0.0;
+
+    printf("threads,streams,s,updates,seconds,updates/s,speedup,same\n");
+    for (int threads = 1; ; threads = std::min(2*threads, maxThreads)) {
+
+        StreamPool pool;
+        if (initStreamPool(&pool, threads, streams, s, sketchBound, alpha, capacity, batch)) {
+            std::cerr << "ERROR: invalid pool configuration\n";
+            return 1;
+        }
+
+        Item *out = (threads == 1) ? reference : results;
+        auto start = std::chrono::steady_clock::now();
+        pushPoolBatch(&pool, ids, items, n, out);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        destroyStreamPool(&pool);
+
+        if (threads == 1) {
+            base = seconds;
+        }
+        printf("%d,%d,%d,%ld,%.3f,%.0f,%.2f,%d\n", threads, streams, s, n, seconds, n/seconds, base/seconds, (threads == 1) || sameResults(reference, results, n));
+        fflush(stdout);
+
+        if (threads == maxThreads) {
+            break;
+        }
+    }//for threads
+
+    free(ids);
+    free(items);
+    free(reference);
+    free(results);
+    return 0;
+}
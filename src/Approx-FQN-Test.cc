@@ -15,295 +15,90 @@
 
 
 
-#include "DDSketch.h"
+#include "Engine.h"
 #include "IIS.h"
+#include "Pipeline.h"
+#include "Policies.h"
+#include "StreamRouter.h"
 #include "QuickSelect.h"
 #include "Utility.h"
+#include "WindowKernel.h"
 
-char VERSION[] = "AFQNv1";      
-double NULLBOUND;               
+#include <cstring>
 
+// Processing of the stream buffered in stats with one combination of execution policies
+template <class OutputT, class ValidationT, class SelectionT>
+int runStream(Counters& stats, int s, int sketchBound, double alpha, RunModes modes) {
 
-int main(int argc, char *argv[]) {
-        
-    if (argc == 1) {
-        printUsage(argv[0]);
-        exit(1);
-    }//fi argc
-    
-    // *********************** STREAM STATISTICS 
-    
-    Counters stats; 
-    initOutliersStats(&stats);                      
+    OutputT output;
+    ValidationT validation;
 
-    
-    // *********************** PROCESSING CONSTRAINTS
-    
-    int s;                                         
-    long N;                                        
-    int sketchBound;                               
-    double alpha;                                 
-    int diff_fraction = 1;
-
-    
-    
-    int isNotValid = checkCommandLineConfiguration(argc, argv, &s, &sketchBound, &alpha, &stats);   
-    if (isNotValid) {
-        std::cerr << " Command line configuration and options are not valid\n";
-        return isNotValid;
+    AfqnEngine engine;
+    if (initEngine(&engine, s, sketchBound, alpha, modes.diffFraction, modes.selection)) {
+        std::cerr << "ERROR: invalid engine configuration\n";
+        return 1;
     }
+    if (setEngineThreads(&engine, modes.windowThreads)) {
+        std::cerr << "ERROR: this build cannot split the update over threads\n";
+        destroyEngine(&engine);
+        return 1;
+    }
+    stats.QnScale = engine.QnScale;
 
-    // *********************** TIME (SLIDING) WINDOW
-    
-    double window[s];                              
-    long seqNo[s];                                 
-    long sLen = 0;                                 
-    int pos = -1;                                  
-    int middle_index = s/2;                        
-    
-    
-    // *********************** (SLIDING) MEDIAN OF THE TIME WINDOW    
-    int median_index = s/2;                          
-    double Pwindow[s];                             
-    int IIS_pos = -1;                              
-    
-    // *********************** Qn OF THE TIME WINDOW
+    // *********************** LOGS 
+    initResultFilename(&stats, s, sketchBound); 
+    validation.open(&stats, s, sketchBound, modes.diffFraction);
 
-    int h = s/2 + 1;                               
-    int kth = h*(h-1)/2;                           
-    
-    setQnValue(&stats, s);                         
-    int I = s*(s-1)/2;                             
-    
-    double quantile = getQuantileFraction(kth, I); 
-    
-    // *********************** INPUT STREAM and LOGS 
-    bool filemode = true;                          
-    
-    #ifdef TEST  
-        bufferStreamFromFile(&stats);               
-        initResultFilename(&stats, s, sketchBound); 
-    #else    
+    openLog(&stats);
+    output.open(&stats);
 
-        // define the stream distribution params 
-        std::uniform_real_distribution<double> udistribution(stats.xparam, stats.yparam);
-        std::exponential_distribution<double> edistribution(stats.xparam);
-        std::normal_distribution<double> ndistribution(stats.xparam, stats.yparam);
-        
-        std::default_random_engine generator;
-        std::function<double()> randomizer;
-        generator.seed(std::chrono::system_clock::now().time_since_epoch().count());
 
-        if (stats.filename != NULL) { 
-    
-            initResultFilename(&stats, s, sketchBound);
-            initExactFilename(&stats, s, sketchBound);
-
-        } else {
-            filemode = false;  
-            
-            if (stats.dtype == 1) {
-                stats.filename = strndup("Uniform", strlen("Uniform"));
-                randomizer = std::bind(udistribution, generator);
-            } else if (stats.dtype == 2) {
-                stats.filename = strndup("Exponential", strlen("Exponential"));
-                randomizer = std::bind(edistribution, generator);
-            } else {
-                stats.filename = strndup("Normal", strlen("Normal"));
-                randomizer = std::bind(ndistribution, generator);
-            }//fi dtype
-            
-            initResultFilename(&stats, s, sketchBound);
-            initExactFilename(&stats, s, sketchBound);
-        }//fi
+    // ************************************ Starting processing
+    logStartup(s, sketchBound, stats.MaxStreamLen, engine.I, engine.kth, engine.quantile, modes.diffFraction, engine.currentAlpha, engine.currentGamma, stats.QnScale, ValidationT::banner());   
+    std::cout << "\tOutput: " << OutputT::name() << ", difference selection: " << SelectionT::name();
+    std::cout << " (" << engine.ndiffs << " of " << s-1 << " differences per item";
+    if (modes.windowThreads > 1) {
+        std::cout << ", " << modes.windowThreads << " threads";
+    }
+    std::cout << ")" << std::endl;
+    std::cout << "\tWindow kernel: " << getKernelName(getKernelLevel());
+    #if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+        std::cout << ", " << (hasFixedWindow(s) ? "fixed" : "runtime") << " size engine";
     #endif
-
-    openLog(&stats);
-
-    #ifdef CMP
-    Item *loggedPoints = (Item *)malloc(sizeof(Item)* stats.streamLen); 
-    long pIdx = 0;
+    #ifdef LOGLINEAR
+        std::cout << ", log-linear buckets with " << 52 - engine.Sketch.shift << " mantissa bits";
     #endif
-
-    // *********************** SKETCH vars    
-    std::map< int, int > Sketch;                          
-
-    double currentAlpha = alpha;                          
-    double currentGamma = getCurrentGamma(currentAlpha);  
-    double currentLogG = getCurrentLogG(currentGamma);    
-    
-    NULLBOUND = pow(currentGamma, -MIN_KEY);              
-    int Sketch_population = 0;                            
-    int Sketch_size = 0;                                  
-    int TotalCollapse = 0;                                
-
-    double item;                                          
-    double oldest_item;                                   
-    double estimatedQ, exact_kth;                         
-    double exact_M;                                       
-
-    #ifndef TEST
-        double new_diff, old_diff;                        
-        double errQ;                                      
-    
-        std::vector<double> ExactDiffs(I,0);              
-        int dd = 0;                                       
-
-        char qfilename[FSIZE];
-        std::string name = stats.filename;
-        std::size_t from_p = name.find_last_of("/"); 
-        std::string distr = name.substr(from_p+1, 4); 
-        snprintf(qfilename, FSIZE-1, "./Quantiles-%s-%d-%d.csv", distr.c_str(), s, diff_fraction);
-        
-        FILE *qfile = fopen(qfilename, "w");
-        if (qfile == NULL){
-            fprintf(stderr,"Error opening %s\n", qfilename);
-            exit(1);       
-        }//fi
-        fprintf(qfile, "Population,Bins,Collapses,EMin,Amin,err,index,EQ1,AQ1,err,index,EQ2,AQ2,err,index,EQ3,AQ3,err,index,EMax,AMax,err,index\n");
+    #ifdef FENWICK
+        std::cout << ", Fenwick rank index";
     #endif
-
-
-    // ************************************ Starting processing
-    logStartup(s, sketchBound, stats.MaxStreamLen, I, kth, quantile, diff_fraction, currentAlpha, currentGamma, stats.QnScale);   
+    std::cout << "\n" << std::endl;
     
-    #ifdef TEST
-        item = stats.item_points[sLen];
-    #else
-        if (!filemode) {
-            item = randomizer();
-        } else {
-            item = stats.item_points[sLen];
-        }
-    #endif
-
-    ++sLen;                     
-    ++pos;                      
-    window[pos] = item;         
-    seqNo[pos] = sLen;                                            
-    Pwindow[0] = item;          
-
+    long sLen = 0;
     while (sLen < s) {
-        #ifdef TEST
-            item = stats.item_points[sLen];
-        #else
-            if (!filemode) {
-                item = randomizer();
-            } else {
-                item = stats.item_points[sLen];
-            }    
-        #endif
-        
-        ++sLen;                                   
-        ++pos;
-        window[pos] = item;                        
-        seqNo[pos] = sLen;
-        
-        IIS_pos = isort_v5(Pwindow, pos, item);    
-        Sketch_population += fillSketch(pos, window, currentGamma, currentLogG, Sketch);
-        TotalCollapse += performCollapse(Sketch, sketchBound, &currentAlpha, &currentGamma, &currentLogG, &Sketch_size);    
-        
-        #ifndef TEST
-            for(int j = pos-1; j>=0; --j) { 
-                new_diff = std::abs(window[pos]-window[j]);
-                ExactDiffs[dd] = new_diff;          
-                ++dd;
-            }//for
-        #endif
-
+        fillEngine(&engine, stats.item_points[sLen]);
+        ++sLen;
+        validation.fill(engine.window, engine.pos);
     }//wend
-    
-    exact_M = Pwindow[median_index];                                                              
 
-    #ifndef TEST
-        logQuantiles(qfile, Sketch, TotalCollapse, currentGamma, ExactDiffs.data(), I);
-    #endif
+    validation.logSketch(engine.Sketch, engine.collapses, engine.currentGamma);
     
     
     Timer onlineTime;        
-    
-    Timer medianT, quantileT, loopT;
-    double medianS=0, quantileS=0, loopS=0, sketchS = 0;
-    
     long countchecks = 0;                         
     
     startTimer(&onlineTime);
     for (long i = 0; i < stats.streamLen; i++) {
     
-        #ifdef TEST
-            item = stats.item_points[sLen];
-        #else
-            if (!filemode) {
-                item = randomizer();
-            } else {
-                item = stats.item_points[sLen];
-            }
-        #endif
-        
+        Value oldest_item = slideEngine<SelectionT>(&engine, stats.item_points[sLen]);
         ++sLen;
-        pos = (pos+1)%s;                   
-        oldest_item = window[pos];          
-        window[pos] = item;                 
-        seqNo[pos] = sLen;
-        
-        if (oldest_item != item)
-        {
-            updateSynopsis(oldest_item, item, Pwindow, s, Sketch, currentGamma, currentLogG);
-            TotalCollapse += performCollapse(Sketch, sketchBound, &currentAlpha, &currentGamma, &currentLogG, &Sketch_size);
-        
-        }//fi
-
-        #ifndef TEST
-            for(int l=1; l<s; ++l) {                                                      
-                int id = (pos+l)%s; 
-                new_diff = std::abs(window[pos] - window[id]);
-                old_diff = std::abs(oldest_item - window[id]);
-                std::vector<double>::iterator it = std::find(ExactDiffs.begin(), ExactDiffs.end(), old_diff);
-                if (it != ExactDiffs.end()){
-                    *(it) = new_diff;
-                }//fi
-            }//for l
-            logQuantiles(qfile, Sketch, TotalCollapse, currentGamma, ExactDiffs.data(), I);
-        #endif
+
+        validation.update(engine.window, engine.pos, s, oldest_item, engine.Sketch, engine.collapses, engine.currentGamma);
         
-        exact_M = Pwindow[median_index];
-
-        estimatedQ = estimateQ(Sketch, quantile, currentGamma, I);
-        ++middle_index;                  
-
-        #ifdef CMP        
-            
-            loggedPoints[pIdx].seq = seqNo[middle_index%s];
-            loggedPoints[pIdx].middle = window[middle_index%s];
-            loggedPoints[pIdx].median = exact_M;
-            loggedPoints[pIdx].Qn = stats.QnScale * estimatedQ;
-            loggedPoints[pIdx].collapses = TotalCollapse;
-            loggedPoints[pIdx].alpha = currentAlpha;
-            loggedPoints[pIdx].bins = Sketch.size();
-            
-            if ( (fabs(window[middle_index%s] - exact_M) - (3 * loggedPoints[pIdx].Qn)) > 0 ){
-                loggedPoints[pIdx].isOutlier = 1;
-                ++(stats.approx_out_count);
-            }else{
-                loggedPoints[pIdx].isOutlier = 0;
-                ++(stats.approx_in_count);
-            }//fi check
-
-            ++pIdx;   
-        #else
-                                                           
-            #ifdef TEST
-                OutlierTest(window[middle_index%s], seqNo[middle_index%s], exact_M, estimatedQ, &stats, TotalCollapse, currentAlpha);
-            #else
-                exact_kth = quickselect(ExactDiffs.data(), I, kth-1 );
-                
-                errQ = checkApproximationError(estimatedQ, exact_kth, "k-th order stat");   
-                
-                checkForOutlier(window[middle_index%s], seqNo[middle_index%s], exact_M, estimatedQ, &stats, currentAlpha, TotalCollapse, Sketch_size);
-            
-                exactOutlier(window[middle_index%s], seqNo[middle_index%s], exact_M, exact_kth, &stats, estimatedQ, errQ, currentAlpha, TotalCollapse, Sketch_size);
-            #endif
-       #endif
+        estimateEngine(&engine);
+        int middle = middleEngine(&engine);
+
+        output.record(&stats, engine.Sketch, engine.seqNo[middle], engine.window[middle], engine.median, engine.Qn, engine.collapses, engine.currentAlpha);
+        validation.check(&stats, engine.Sketch, engine.seqNo[middle], engine.window[middle], engine.median, engine.Qn, engine.collapses, engine.currentAlpha);
         
         ++countchecks;                 
     }//for distribution len
@@ -314,51 +109,300 @@ int main(int argc, char *argv[]) {
 
 
     std::cout << "Processing "<< stats.filename << " ended" << std::endl;
-    #ifndef TEST
+    if (ValidationT::exact) {
         std::cout << "\nFound Exact Outliers "<< stats.exact_out_count << "  and " << stats.exact_in_count << " Exact Inliers in stream of length " << sLen << " items\n" << std::endl;
-        std::cout << "\nFound Approximated Outliers "<< stats.approx_out_count << "  and " << stats.approx_in_count << " Approximated Inliers over StreamTotalLength " << N << std::endl;
+        std::cout << "\nFound Approximated Outliers "<< stats.approx_out_count << "  and " << stats.approx_in_count << " Approximated Inliers over StreamTotalLength " << stats.MaxStreamLen << std::endl;
         std::cout << "\nProcessing time (online phase only): "<< getElapsedMilliSecs(&onlineTime) << " ms " << std::endl;
-        std::cout << "Collapse executed " << TotalCollapse << ", Final Alpha " << currentAlpha << ", Final Gamma " << currentGamma;
-        std::cout << ", Final Bins " << Sketch.size() << std::endl;
-    #else
+        std::cout << "Collapse executed " << engine.collapses << ", Final Alpha " << engine.currentAlpha << ", Final Gamma " << engine.currentGamma;
+        std::cout << ", Final Bins " << getSketchSize(engine.Sketch) << std::endl;
+    } else {
         std::cerr << stats.filename << "," << countchecks << "," << s/2 << "," << running_secs << "," << update_per_sec;
         std::cerr << "," <<  stats.approx_out_count << "," << stats.approx_in_count;
         std::cerr << "," << alpha << "," << sketchBound;
-        std::cerr << "," << TotalCollapse << "," << currentAlpha << "," << Sketch.size() << std::endl;
+        std::cerr << "," << engine.collapses << "," << engine.currentAlpha << "," << getSketchSize(engine.Sketch) << std::endl;
+    }//fi
+
+
+    output.close(&stats, s, sketchBound);
+    validation.close();
+
+    closeLog(&stats);
+    destroyEngine(&engine);
+
+    std::cout << "Processing ended!\n\n";
+    return 0;
+}
+
+
+
+// Keyed records series_id,timestamp,value read as they come, each series on its own window:
+// a row per estimate, prefixed by the series id, to Results/<stream>-<s>-<bound>-keyed.csv
+static int runKeyed(Counters& stats, int s, int sketchBound, double alpha, RunModes modes) {
+
+    StreamRouter router;
+    if (initStreamRouter(&router, modes.maxKeys, modes.idleTimeout, s, sketchBound, alpha, 4*sketchBound)) {
+        std::cerr << "ERROR: invalid keyed configuration\n";
+        return 1;
+    }
+
+    FILE *fp = fopen(stats.filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr,"Error opening %s\n", stats.filename);
+        destroyStreamRouter(&router);
+        return 1;
+    }
+
+    const char *sub = strrchr(stats.filename, '/');
+    std::string name = (sub == NULL) ? stats.filename : sub + 1;
+    name = name.substr(0, name.find_last_of('.'));
+    char fname[FSIZE];
+    snprintf(fname, FSIZE-1, "Results/%s-%d-%d-keyed.csv", name.c_str(), s, sketchBound);
+    FILE *logF = fopen(fname, "w");
+    if (logF == NULL) {
+        fprintf(stderr,"Error opening %s\n", fname);
+        fclose(fp);
+        destroyStreamRouter(&router);
+        return 1;
+    }
+
+    std::cout << "\tKeyed records: at most " << modes.maxKeys << " live series of " << getStreamBytes(&router.set) << " bytes";
+    std::cout << ", idle timeout " << modes.idleTimeout << "\n" << std::endl;
+
+    Timer onlineTime;
+    long records = 0;
+    long skipped = 0;
+    long estimates = 0;
+    char *line = NULL;
+    size_t dim = 0;
+
+    startTimer(&onlineTime);
+    while (records < stats.streamLen && getline(&line, &dim, fp) != -1) {
+
+        char *comma = strchr(line, ',');
+        char *end;
+        double timestamp = (comma == NULL) ? 0.0 : strtod(comma + 1, &end);
+        if (comma == NULL || comma == line || end == comma + 1 || *end != ',') {
+            ++skipped;
+            continue;
+        }
+        Value item = strtod(end + 1, NULL);
+        ++records;
+
+        Item result;
+        if (routeItem(&router, line, comma - line, timestamp, item, &result)) {
+            ++estimates;
+            result.isOutlier ? ++stats.approx_out_count : ++stats.approx_in_count;
+            fprintf(logF, "%.*s,%ld,%.6f,%.6f,%.6f,%d,%d,%.6f,%d\n", (int)(comma - line), line, result.seq, result.middle, result.median, result.Qn, result.isOutlier, result.collapses, result.alpha, result.bins);
+        }
+    }//wend records
+    stopTimer(&onlineTime);
+
+    double running_secs = (getElapsedMilliSecs(&onlineTime)/1000.0);
+    std::cout << "Processing "<< stats.filename << " ended: " << router.created << " series, " << router.idleEvictions << " evicted idle, ";
+    std::cout << router.forcedEvictions << " evicted to make room, " << router.liveKeys << " live, " << skipped << " malformed records skipped" << std::endl;
+    std::cerr << stats.filename << "," << records << "," << estimates << "," << running_secs << "," << records/running_secs;
+    std::cerr << "," << stats.approx_out_count << "," << stats.approx_in_count;
+    std::cerr << "," << alpha << "," << sketchBound;
+    std::cerr << "," << router.created << "," << router.idleEvictions << "," << router.forcedEvictions << "," << router.peakBytes << std::endl;
+
+    free(line);
+    fclose(fp);
+    fclose(logF);
+    destroyStreamRouter(&router);
+
+    std::cout << "Processing ended!\n\n";
+    return 0;
+}
+
+
+
+// Stream read by an ingest thread and its estimates logged by an output thread while the
+// engine runs here, batches going between them (see Pipeline.h): the -o cmp log of runStream,
+// with the whole run timed, reading and writing included
+static int runPipelined(Counters& stats, int s, int sketchBound, double alpha, RunModes modes) {
+
+    AfqnEngine engine;
+    if (initEngine(&engine, s, sketchBound, alpha, modes.diffFraction, modes.selection)) {
+        std::cerr << "ERROR: invalid engine configuration\n";
+        return 1;
+    }
+    if (setEngineThreads(&engine, modes.windowThreads)) {
+        std::cerr << "ERROR: this build cannot split the update over threads\n";
+        destroyEngine(&engine);
+        return 1;
+    }
+    stats.QnScale = engine.QnScale;
+
+    logStartup(s, sketchBound, stats.MaxStreamLen, engine.I, engine.kth, engine.quantile, modes.diffFraction, engine.currentAlpha, engine.currentGamma, stats.QnScale, NoValidation::banner());
+
+    Timer onlineTime;
+    startTimer(&onlineTime);
+
+    Pipeline pipe;
+    if (startPipeline(&pipe, &stats, modes.pipeBatch, s, sketchBound)) {
+        destroyEngine(&engine);
+        return 1;
+    }
+
+    std::cout << "\tPipeline: " << stats.filename << " read, processed and logged on three threads, batches of " << modes.pipeBatch << " items";
+    std::cout << " (" << engine.ndiffs << " of " << s-1 << " differences per item";
+    if (modes.windowThreads > 1) {
+        std::cout << ", " << modes.windowThreads << " threads";
+    }
+    std::cout << ")\n" << std::endl;
+
+    long count;
+    long countchecks = 0;
+    const Value *items;
+    while ((items = nextItems(&pipe, &count)) != NULL) {
+        long written = pushEngineBatch(&engine, items, count, nextResults(&pipe));
+        passResults(&pipe, written);
+        countchecks += written;
+    }//wend batches
+
+    finishPipeline(&pipe);
+    stopTimer(&onlineTime);
+    stats.approx_out_count = pipe.outliers;
+    stats.approx_in_count = pipe.inliers;
+
+    double running_secs = (getElapsedMilliSecs(&onlineTime)/1000.0);
+    std::cout << "Processing "<< stats.filename << " ended" << std::endl;
+    std::cerr << stats.filename << "," << countchecks << "," << s/2 << "," << running_secs << "," << countchecks/running_secs;
+    std::cerr << "," <<  stats.approx_out_count << "," << stats.approx_in_count;
+    std::cerr << "," << alpha << "," << sketchBound;
+    std::cerr << "," << engine.collapses << "," << engine.currentAlpha << "," << getSketchSize(engine.Sketch) << std::endl;
+
+    destroyEngine(&engine);
+
+    std::cout << "Processing ended!\n\n";
+    return 0;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Policy dispatch
+
+typedef int (*RunFunction)(Counters& stats, int s, int sketchBound, double alpha, RunModes modes);
+
+
+template <class OutputT, class ValidationT>
+static RunFunction selectRun(SelectionMode selection, int diff_fraction) {
+    
+    #if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+        if (diff_fraction > 1) {
+            if (selection == UNIFORM_SELECTION) {
+                return runStream<OutputT, ValidationT, UniformSelection>;
+            }
+            return runStream<OutputT, ValidationT, NearestSelection>;
+        }//fi partial
     #endif
+    return runStream<OutputT, ValidationT, FullSelection>;
+}
 
 
-    #ifdef CMP
-        char *sub = strrchr(stats.filename, '/');
-        char fname[FSIZE];
-        
-        int len = strlen(&sub[1]);
-        char stripped[len-4];
-        strncpy(stripped, &sub[1], len-4);
-        stripped[len-4]='\0';
-        
-        snprintf(fname, FSIZE-1, "Results/%s-%d-%d.csv", stripped, s, sketchBound);
-        
-        FILE *logF = fopen(fname, "w");
-        if (logF != NULL) {
-        
-            for(long u = 0; u<pIdx; ++u) {
-                fprintf(logF, "%ld,%.6f,%.6f,%.6f,%d,%d,%.6f,%d\n", loggedPoints[u].seq, loggedPoints[u].middle, loggedPoints[u].median, loggedPoints[u].Qn, loggedPoints[u].isOutlier, loggedPoints[u].collapses,loggedPoints[u].alpha,loggedPoints[u].bins);
-            }//for 
+template <class OutputT, class ValidationT>
+static RunFunction selectRun(SelectionMode selection, int diff_fraction, int window_threads) {
 
-            fclose(logF);
-            free(loggedPoints);
-        }//fi
+    #if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+        if (window_threads > 1) {
+            return runStream<OutputT, ValidationT, TeamUpdate>;
+        }
     #endif
+    return selectRun<OutputT, ValidationT>(selection, diff_fraction);
+}
 
-    closeLog(&stats);
-    destroyOutliersStats(&stats);
 
-    #ifndef TEST
-        fclose(qfile);
+template <class OutputT>
+static RunFunction selectRun(ValidationMode validation, SelectionMode selection, int diff_fraction, int window_threads) {
+
+    switch (validation) {
+        case EXACT_VALIDATION:
+            return selectRun<OutputT, ExactValidation>(selection, diff_fraction, window_threads);
+        case TRACE_VALIDATION:
+            return selectRun<OutputT, TraceValidation>(selection, diff_fraction, window_threads);
+        default:
+            return selectRun<OutputT, NoValidation>(selection, diff_fraction, window_threads);
+    }//switch
+}
+
+
+static RunFunction selectRun(RunModes modes) {
+
+    switch (modes.output) {
+        case BUFFERED_OUTPUT:
+            return selectRun<BufferedOutput>(modes.validation, modes.selection, modes.diffFraction, modes.windowThreads);
+        case FILE_OUTPUT:
+            return selectRun<FileOutput>(modes.validation, modes.selection, modes.diffFraction, modes.windowThreads);
+        default:
+            return selectRun<CompareOutput>(modes.validation, modes.selection, modes.diffFraction, modes.windowThreads);
+    }//switch
+}
+
+
+
+int main(int argc, char *argv[]) {
+        
+    if (argc == 1) {
+        printUsage(argv[0]);
+        exit(1);
+    }//fi argc
+    
+    // *********************** STREAM STATISTICS 
+    
+    Counters stats; 
+    initOutliersStats(&stats);                      
+
+    
+    // *********************** PROCESSING CONSTRAINTS
+    
+    int s;                                         
+    int sketchBound;                               
+    double alpha;                                 
+    RunModes modes;
+
+    
+    
+    int isNotValid = checkCommandLineConfiguration(argc, argv, &s, &sketchBound, &alpha, &modes, &stats);   
+    if (isNotValid) {
+        std::cerr << " Command line configuration and options are not valid\n";
+        return isNotValid;
+    }
+
+    #if defined(LARGE_WINDOW)
+        if (modes.validation != NO_VALIDATION) {
+            std::cerr << "ERROR: the large-window build keeps no exact differences, run it with -v none\n";
+            return 1;
+        }
+    #endif
+    #if defined(LARGE_WINDOW) || defined(RUNLENGTH)
+        if (modes.diffFraction > 1) {
+            std::cerr << "ERROR: partial updates need the plain sorted window, run this build with -t 1\n";
+            return 1;
+        }
     #endif
 
-    std::cout << "Processing ended!\n\n";
-    return 0;
+    if (modes.maxKeys) {
+        int res = runKeyed(stats, s, sketchBound, alpha, modes);
+        destroyOutliersStats(&stats);
+        return res;
+    }
+
+    if (modes.pipeBatch) {
+        int res = runPipelined(stats, s, sketchBound, alpha, modes);
+        destroyOutliersStats(&stats);
+        return res;
+    }
+
+    // *********************** INPUT STREAM 
+    if (stats.filename != NULL) {
+        bufferStreamFromFile(&stats);               
+    } else {
+        bufferStreamFromDistribution(&stats);
+    }//fi
+
+    int res = selectRun(modes)(stats, s, sketchBound, alpha, modes);
+
+    destroyOutliersStats(&stats);
+    return res;
 }
 
@@ -0,0 +1,77 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "DDSketch.h"
+
+#include <unistd.h>
+
+// Equivalence of the fast sketch keys with the log10 ones, for every gamma the collapses
+// reach from each initial alpha; needs no stream and writes no file
+
+
+static void printVerifyUsage(const char *name) {
+
+    fprintf(stderr, "Usage: %s [-a alpha] ...\n", name);
+    fprintf(stderr, "Checks getKeyFor() against getKeyForLog10() for the gamma of every alpha the collapses reach\n");
+    fprintf(stderr, "from each given one (by default %g, 0.0005, 0.001 and 0.01); exits with 1 on a mismatch\n", MIN_ALPHA);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    std::vector<double> alphas;
+
+    int c;
+    while ((c = getopt(argc, argv, "a:h")) != -1) {
+        switch (c) {
+            case 'a': alphas.push_back(strtod(optarg, NULL)); break;
+            default:
+                printVerifyUsage(argv[0]);
+                return 1;
+        }//switch
+    }//wend getopt()
+
+    if (alphas.empty()) {
+        alphas = {MIN_ALPHA, 0.0005, 0.001, 0.01};
+    }
+
+    int mismatches = 0;
+    for (double alpha : alphas) {
+
+        if (alpha < MIN_ALPHA || alpha >= 1.0) {
+            printVerifyUsage(argv[0]);
+            return 1;
+        }
+
+        std::cout << "Initial alpha " << alpha << std::endl;
+        for (double a = alpha; a < 1.0; a = getCurrentAlpha(a)) {
+            double g = getCurrentGamma(a);
+            mismatches += verifyKeyFor(g, getCurrentLogG(g));
+            if (a == getCurrentAlpha(a)) {
+                break;
+            }
+        }//for collapses
+    }//for alphas
+
+    if (mismatches) {
+        std::cerr << "ERROR: fast key computation differs from the reference one in " << mismatches << " values\n";
+        return 1;
+    }
+    std::cout << "Fast keys match the reference ones" << std::endl;
+    return 0;
+}
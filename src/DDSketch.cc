@@ -17,13 +17,21 @@
 
 
 #include "DDSketch.h"
+#include "FastKey.h"
+#include "IntKey.h"
+#include "WindowKernel.h"
+#include "DenseSketch.h"
+#include "FenwickSketch.h"
+#include "SketchPyramid.h"
+#include "LogLinearSketch.h"
 #include "QuickSelect.h"
 
-extern double NULLBOUND;   
+#include <cfloat>
+
 
 //****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Utility functions
 
-int getKeyFor(double value, double gamma, double logG) {
+int getKeyForLog10(double value, double gamma, double logG) {
     
     if (value <= NULLBOUND) {
         #ifdef DEBUG
@@ -34,6 +42,128 @@ int getKeyFor(double value, double gamma, double logG) {
     return std::ceil(std::log10(value)/logG);
 }
 
+
+// Same key as getKeyForLog10(): ceil(log2(value)*log10(2)/logG) is taken from the
+// exponent bits and a table-driven log2, unless it falls within KEY_SLACK of a bucket
+// boundary, where only the reference computation is guaranteed to agree with itself
+int getKeyFor(double value, double gamma, double logG) {
+
+    if (value <= NULLBOUND) {
+        return getKeyForLog10(value, gamma, logG);
+    }
+
+    int key;
+    if (fastKey(value, LOG10_2/logG, &key)) {
+        return key;
+    }
+    return getKeyForLog10(value, gamma, logG);
+}
+
+
+// 1 if getKeyFor() and getKeyForLog10() differ on value; the first 10 mismatches are printed
+static int keyMismatch(double value, double gamma, double logG, int mismatches) {
+
+    int fast = getKeyFor(value, gamma, logG);
+    int reference = getKeyForLog10(value, gamma, logG);
+    if (fast == reference) {
+        return 0;
+    }
+    if (mismatches < 10) {
+        fprintf(stderr, "verifyKeyFor(): key mismatch for %.17g: %d vs %d\n", value, fast, reference);
+    }
+    return 1;
+}
+
+
+// Smallest double whose getKeyForLog10() key exceeds k, bisected on the bit patterns around
+// 10^(k logG), whose own rounding error reaches hundreds of ulps in the extreme binades;
+// 0 if the bracket leaves the normal doubles
+static double findKeyBoundary(int k, double gamma, double logG) {
+
+    double approx = std::pow(10.0, k*logG);
+    double below = approx*(1.0 - 1e-9);
+    double above = approx*(1.0 + 1e-9);
+    if (!std::isnormal(below) || !std::isnormal(above) || getKeyForLog10(below, gamma, logG) > k || getKeyForLog10(above, gamma, logG) <= k) {
+        return 0.0;
+    }
+
+    uint64_t lo, hi;
+    memcpy(&lo, &below, sizeof(lo));
+    memcpy(&hi, &above, sizeof(hi));
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo)/2;
+        double value;
+        memcpy(&value, &mid, sizeof(value));
+        if (getKeyForLog10(value, gamma, logG) > k) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }//wend
+
+    double boundary;
+    memcpy(&boundary, &hi, sizeof(boundary));
+    return boundary;
+}
+
+
+// Compares getKeyFor() with getKeyForLog10() over the normal doubles, [DBL_MIN, DBL_MAX]:
+// KEY_CHECK_ULPS values on either side of the bucket boundaries, and random mantissas in every
+// binade. All the boundaries are checked while there are at most KEY_CHECK_BOUNDARIES of
+// them; those of a finer gamma are drawn uniformly. Sampling them is enough because fastKey()
+// keeps a key only when log2(value)*scale lies more than KEY_SLACK*(|x| + 4 scale) from an
+// integer: the exponent enters fastLog2() exactly, and the error of the mantissa part does
+// not depend on it, so every binade and boundary has the margin of the checked ones.
+// Zero, subnormal and non-finite values take the log10 path in getKeyFor() as well.
+int verifyKeyFor(double gamma, double logG) {
+
+    const int KEY_CHECK_ULPS = 8;
+    const long KEY_CHECK_BOUNDARIES = 1 << 20;
+    const int KEY_CHECK_SAMPLES = 1024;
+
+    long checked = 0;
+    int mismatches = 0;
+
+    int firstKey = getKeyForLog10(DBL_MIN, gamma, logG);
+    int lastKey = getKeyForLog10(DBL_MAX, gamma, logG);
+    long keys = (long)lastKey - firstKey + 1;
+    long boundaries = std::min(keys, KEY_CHECK_BOUNDARIES);
+
+    std::mt19937_64 generator(KEY_CHECK_SAMPLES);
+    std::uniform_int_distribution<int> drawKey(firstKey, lastKey);
+    for (long b = 0; b < boundaries; ++b) {
+
+        int k = (boundaries == keys) ? (int)(firstKey + b) : drawKey(generator);
+        double boundary = findKeyBoundary(k, gamma, logG);
+        if (boundary == 0.0) {
+            continue;
+        }
+
+        mismatches += keyMismatch(boundary, gamma, logG, mismatches);
+        double below = boundary, above = boundary;
+        for (int u = 0; u < KEY_CHECK_ULPS; ++u) {
+            below = std::nextafter(below, 0.0);
+            above = std::nextafter(above, HUGE_VAL);
+            mismatches += keyMismatch(below, gamma, logG, mismatches);
+            mismatches += keyMismatch(above, gamma, logG, mismatches);
+        }//for u
+        checked += 2*KEY_CHECK_ULPS + 1;
+    }//for b
+
+    std::uniform_real_distribution<double> mantissa(1.0, 2.0);
+    for (int e = DBL_MIN_EXP-1; e < DBL_MAX_EXP; ++e) {
+        for (int j = 0; j < KEY_CHECK_SAMPLES; ++j) {
+            mismatches += keyMismatch(std::ldexp(mantissa(generator), e), gamma, logG, mismatches);
+        }//for j
+        checked += KEY_CHECK_SAMPLES;
+    }//for e
+
+    std::cout << "\tverifyKeyFor(): gamma " << gamma << ", keys [" << firstKey << ", " << lastKey << "], ";
+    std::cout << ((boundaries == keys) ? "all " : "") << boundaries << " boundaries, ";
+    std::cout << checked << " values checked, " << mismatches << " mismatches" << std::endl;
+    return mismatches;
+}
+
 double getCurrentAlpha(double alpha) {
     return 2*(alpha/(1 + pow(alpha,2)));
 }
@@ -48,7 +178,7 @@ double getCurrentLogG(double gamma) {
 
 
 
-double getQuantileFraction(int kth, int I) {
+double getQuantileFraction(long kth, long I) {
 
     double q = (double)floor( (kth-1)*100/(I-1) );     
     q /= 100.0;
@@ -60,15 +190,15 @@ double getQuantileFraction(int kth, int I) {
 }
 
 
-double estimateQ(std::map<int, int>& Sketch, double q, double gamma, int n) {
+double estimateQ(MapSketch& Sketch, double q, double gamma, long n) {
 
     double estimate = 0.0;
     double fraction = q*(n-1);
     
     
-    std::map<int, int>::iterator it = Sketch.begin();
+    MapSketch::iterator it = Sketch.begin();
     int i = it->first;
-    int count = it->second;
+    BinCount count = it->second;
     
     while (count <= fraction) {
         ++it;
@@ -86,25 +216,41 @@ double estimateQ(std::map<int, int>& Sketch, double q, double gamma, int n) {
 }
 
 
-void debugSketch(std::map< int, int>& mySketch) {
+int getSketchBuckets(MapSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity) {
+
+    if ((int)mySketch.size() > capacity) {
+        return -1;
+    }
+
+    int b = 0;
+    for (MapSketch::iterator it = mySketch.begin(); it != mySketch.end(); ++it) {
+        values[b] = (it->first == -MIN_KEY) ? 0.0 : (2.0 * pow(gamma,it->first))/(gamma+1.0);
+        counts[b] = it->second;
+        ++b;
+    }//for
+    return b;
+}
+
+
+void debugSketch(MapSketch& mySketch) {
 
     fprintf(stdout,"\nSketch is : \n\t Key \t Count\n");
-    int TotalCount = accumulate( mySketch.begin(), mySketch.end(), 0, []( int acc, std::pair<int, int> p ) { return ( acc + p.second ); } );
+    BinCount TotalCount = getSketchPopulation(mySketch);
     
     int loop= 1;
     for(auto it=mySketch.begin(); it != mySketch.end(); ++it) {
-        fprintf(stdout,"%d) \t%+12d, \t%d\n", loop++, it->first, it->second);
+        fprintf(stdout,"%d) \t%+12d, \t%ld\n", loop++, it->first, it->second);
     }//for
-    fprintf(stdout,"Total differences contained in sketch %d, over %lu buckets\n\n", TotalCount, mySketch.size());
+    fprintf(stdout,"Total differences contained in sketch %ld, over %lu buckets\n\n", TotalCount, mySketch.size());
 }
 
 
 
 
-double estimator(std::map< int, int>&mySketch, double q, double gamma) {
+double estimator(MapSketch& mySketch, double q, double gamma) {
 
     double sum = 0;
-    std::map< int, int>::iterator it = mySketch.begin();
+    MapSketch::iterator it = mySketch.begin();
 
     int i = it->first;
     double b_count = it->second;
@@ -120,14 +266,11 @@ double estimator(std::map< int, int>&mySketch, double q, double gamma) {
     return (2.0 * pow(gamma,i))/(gamma+1.0);
 }
 
-void logQuantiles(FILE *fp, std::map< int,int>&mySketch, int collapses, double gamma, double *exactDiffs, int len) {
+template <class SketchT>
+void logQuantiles(FILE *fp, SketchT& mySketch, int collapses, double gamma, double *exactDiffs, int len) {
     
     double I = 1.0*len; 
-    double population = 0;
-    std::map< int,int >::iterator it;
-    for (it = mySketch.begin(); it != mySketch.end(); ++it) {
-        population +=it->second;
-    }//for (it)
+    double population = getSketchPopulation(mySketch);
 
     double Amin = estimator(mySketch, 0.00,  gamma);
     double Aq1 = estimator(mySketch, 0.25*(population-1),  gamma);
@@ -141,7 +284,7 @@ void logQuantiles(FILE *fp, std::map< int,int>&mySketch, int collapses, double g
     double Eq3 = quickselect(exactDiffs, len, (int)std::ceil(3*I/4.0)-1 ); 
     double Emax = quickselect(exactDiffs, len, len-1); 
 
-    fprintf(fp, "%.0f,%lu,%d,", population, mySketch.size(), collapses);
+    fprintf(fp, "%.0f,%d,%d,", population, getSketchSize(mySketch), collapses);
     fprintf(fp, "%.6f,%.6f,%.6f,%d,", Emin, Amin, std::abs((Amin-Emin)/Emin),0);    
     fprintf(fp, "%.6f,%.6f,%.6f,%d,", Eq1, Aq1, std::abs((Aq1-Eq1)/Eq1),(int)std::ceil(I/4.0)-1);
     fprintf(fp, "%.6f,%.6f,%.6f,%d,", Eq2, Aq2, std::abs((Aq2-Eq2)/Eq2),(int)std::ceil(I/2.0)-1);
@@ -153,15 +296,15 @@ void logQuantiles(FILE *fp, std::map< int,int>&mySketch, int collapses, double g
 
 //****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Uniform Collapse of the sketch
 
-void uniformCollapse(std::map<int, int>& mySketch) {
+void uniformCollapse(MapSketch& mySketch) {
  
-    std::map<int, int> newSketch; 
+    MapSketch newSketch(mySketch.key_comp(), mySketch.get_allocator()); 
     
-    std::map<int, int>::iterator it = mySketch.begin();
+    MapSketch::iterator it = mySketch.begin();
     while (it != mySketch.end() ) {
 
         int key = it->first;
-        std::map<int, int>::iterator it_collapsed;
+        MapSketch::iterator it_collapsed;
 
         if (key%2 != 0) 
         {
@@ -197,34 +340,38 @@ void uniformCollapse(std::map<int, int>& mySketch) {
 }
 
 
-void collapseUniformly(std::map<int, int>& mySketch) {
+// Keys are visited in order and ceil(k/2) is monotone, so every bucket is appended
+// at the end of the new map. Each node is erased before the next one is inserted:
+// with a NodePool the insertion reuses it and the collapse does not allocate.
+void collapseUniformly(MapSketch& mySketch) {
 
-    std::map<int, int> newSketch; 
-    std::map<int, int>::iterator it;
-
-    it = mySketch.begin();
-    if (it->first == -MIN_KEY) { 
-        newSketch[-MIN_KEY] += it->second;
-        ++it;
-    }
+    MapSketch newSketch(mySketch.key_comp(), mySketch.get_allocator()); 
+    MapSketch::iterator last = newSketch.end();
 
+    MapSketch::iterator it = mySketch.begin();
     while(it != mySketch.end()){
         
-        double k = it->first;
-        int k_new = std::ceil(k/2);
-        newSketch[k_new] += it->second;
-        
-        ++it;
+        int k = it->first;
+        int k_new = (k == -MIN_KEY) ? k : -((-k) >> 1);
+        BinCount count = it->second;
+        it = mySketch.erase(it);
+
+        if (last != newSketch.end() && last->first == k_new) {
+            last->second += count;
+        } else {
+            last = newSketch.emplace_hint(newSketch.end(), k_new, count);
+        }
     }//wend
 
     mySketch.swap(newSketch);
 }
 
 
-int performCollapse(std::map<int, int>& Sketch, int sketchBound, double *currentAlpha, double *currentGamma, double *currentLogG, int *SketchSize) {
+template <class SketchT>
+int performCollapse(SketchT& Sketch, int sketchBound, double *currentAlpha, double *currentGamma, double *currentLogG, int *SketchSize) {
 
     int collapse_executed = 0;
-    int currentSize = Sketch.size();
+    int currentSize = getSketchSize(Sketch);
 
     while (currentSize > sketchBound) { 
     
@@ -235,15 +382,15 @@ int performCollapse(std::map<int, int>& Sketch, int sketchBound, double *current
         collapseUniformly(Sketch); 
         ++collapse_executed; 
         
-        currentSize = Sketch.size();
+        currentSize = getSketchSize(Sketch);
 
         #ifdef DEBUG
             std::cout << "New error params [current (α, 𝛄, LogG) " << *currentAlpha;
             std::cout << ", " << *currentGamma;
             std::cout << ", " << *currentLogG << " ]" << std::endl;
         
-            int TotalCount = accumulate( Sketch.begin(), Sketch.end(), 0, []( int acc, std::pair<int, int> p ) { return ( acc + p.second ); } );
-            std::cout<< "After " << collapse_executed << " collapse() the sketch size is "<< Sketch.size();
+            BinCount TotalCount = getSketchPopulation(Sketch);
+            std::cout<< "After " << collapse_executed << " collapse() the sketch size is "<< currentSize;
             std::cout<< "\tTotal count: " << TotalCount << std::endl;
         #endif
 
@@ -256,20 +403,30 @@ int performCollapse(std::map<int, int>& Sketch, int sketchBound, double *current
 
 //****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Filling the sketch
 
-int fillSketch(int pos, double *window, double gamma, double LogG, std::map<int, int>& Sketch) {
+// Key of |a - b| in the bucketing of the sketch, the difference taken in T (exactly for ints)
+template <class SketchT, class T>
+static inline int getDiffKey(T a, T b, SketchT& Sketch, double gamma, double logG) {
+    return getSketchKey(Sketch, std::abs(a - b), gamma, logG);
+}
+
+template <class SketchT>
+static inline int getDiffKey(int a, int b, SketchT& Sketch, double gamma, double logG) {
+    return getIntSketchKey(Sketch, intDiff(a, b), gamma, logG);
+}
+
+
+template <class SketchT, class T>
+int fillSketch(int pos, T *window, double gamma, double LogG, SketchT& Sketch) {
 
-    double new_diff = -1;
     int currentBi;
     int count_added = 0;
 
    
     for(int j = pos-1; j>=0; --j) {            
 
-        new_diff = std::abs(window[pos]-window[j]);
+        currentBi = getDiffKey(window[pos], window[j], Sketch, gamma, LogG);   
 
-        currentBi = getKeyFor(new_diff, gamma, LogG);   
-
-        Sketch[currentBi] += 1;
+        incrementBinCount(currentBi, Sketch);
 
         ++count_added;                                              
     }//for ADD diffs
@@ -280,20 +437,21 @@ int fillSketch(int pos, double *window, double gamma, double LogG, std::map<int,
 
 //****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Update the sketch
 
-int uniformRemove(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+template <class SketchT, class T>
+int uniformRemove(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
     
-    double old_item = Pwindow[pos];
+    T old_item = Pwindow[pos];
     int sample = (s-1)/ndiffs; //sampling frequency: one difference every "sample" items
     int key,res;
 
     int r = pos + 1;
     int l = pos - 1;
     int count = 0, i=0;
-    while ((count < ndiffs) && (l>=0 || r<s)) {    
+    while ((count < ndiffs) && (i < sample) && (l>=0 || r<s)) {     // past sample offsets the differences repeat
 
             while ((r < s) && (count<ndiffs)) {
 
-                key = getKeyFor(std::abs(Pwindow[r]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, absDiff(Pwindow[r], old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
 
                 if (res == 1) {
@@ -305,7 +463,7 @@ int uniformRemove(std::map<int,int> &sketch, double gamma, double logGamma, int
            
             while ((l >= 0) && (count<ndiffs)) {
 
-                key = getKeyFor(std::abs(Pwindow[l]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, absDiff(Pwindow[l], old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 
                 if (res == 1) {
@@ -323,9 +481,10 @@ int uniformRemove(std::map<int,int> &sketch, double gamma, double logGamma, int
     return count;
 }
 
-int uniformAdd(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+template <class SketchT, class T>
+int uniformAdd(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
 
-    double new_item = Pwindow[pos];
+    T new_item = Pwindow[pos];
     
     int r = pos + 1;
     int l = pos - 1;
@@ -335,8 +494,8 @@ int uniformAdd(std::map<int,int> &sketch, double gamma, double logGamma, int pos
     int sample = (s-1)/ndiffs; 
             
             while (r < s && count<ndiffs){
-                key = getKeyFor(std::abs(Pwindow[r]-new_item), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, absDiff(Pwindow[r], new_item), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 
                 r+=sample;
                 ++count;
@@ -344,8 +503,8 @@ int uniformAdd(std::map<int,int> &sketch, double gamma, double logGamma, int pos
             }
            
             while (l >= 0 && count<ndiffs){
-                key = getKeyFor(std::abs(Pwindow[l]-new_item), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, absDiff(Pwindow[l], new_item), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 
                 l-=sample;
                 ++count;
@@ -357,33 +516,44 @@ int uniformAdd(std::map<int,int> &sketch, double gamma, double logGamma, int pos
 
 
 
-int decreaseBinCount(int key, std::map<int, int>& sketch) {
+int decreaseBinCount(int key, MapSketch& sketch) {
     
-    int res = 1;
-    std::map<int, int>::iterator it = sketch.find(key);
+    MapSketch::iterator it = sketch.find(key);
 
     if ( it == sketch.end() ) {
-        res = -1;
-        #ifdef PARTIAL
-            return res;
-        #else // ALL (s-1) differences
-            std::cout<<"removeWeightToSketch(): ERROR: try to remove item from non existing bucket "<< key << "\n";
-            exit(1);
-        #endif
+        return -1;
     }
     
     it->second -= 1;
     if (it->second == 0) {
         sketch.erase(it);
     }
-    return res;
+    return 1;
 }
 
 
 
-int selectDiffsToRemove2(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+int decreaseBinCount(int key, BinCount count, MapSketch& sketch) {
     
-    double old_item = Pwindow[pos];
+    MapSketch::iterator it = sketch.find(key);
+
+    if ( it == sketch.end() || it->second < count ) {
+        return -1;
+    }
+    
+    it->second -= count;
+    if (it->second == 0) {
+        sketch.erase(it);
+    }
+    return 1;
+}
+
+
+
+template <class SketchT, class T>
+int selectDiffsToRemove2(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
+    
+    T old_item = Pwindow[pos];
     int key, res;
     
     int r = pos + 1;
@@ -397,18 +567,18 @@ int selectDiffsToRemove2(std::map<int,int> &sketch, double gamma, double logGamm
         if (r<s && l>=0) {
 
             
-            double d1 = std::abs(Pwindow[l] - old_item);
-            double d2 = std::abs(old_item - Pwindow[r]);
+            double d1 = absDiff(Pwindow[l], old_item);
+            double d2 = absDiff(old_item, Pwindow[r]);
 
             if ( d1 <= d2 ){
-                key = getKeyFor(d1, gamma, logGamma);
+                key = getSketchKey(sketch, d1, gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;    
                 }
                 --l;
             } else {
-                key = getKeyFor(d2, gamma, logGamma);
+                key = getSketchKey(sketch, d2, gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;
@@ -419,7 +589,7 @@ int selectDiffsToRemove2(std::map<int,int> &sketch, double gamma, double logGamm
             quit = 1;
             while ((r<s) && (count<ndiffs)) {
                 
-                key = getKeyFor(std::abs(Pwindow[r]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, absDiff(Pwindow[r], old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;
@@ -429,7 +599,7 @@ int selectDiffsToRemove2(std::map<int,int> &sketch, double gamma, double logGamm
 
             while ((l>=0) && (count<ndiffs)) {
 
-                key = getKeyFor(std::abs(Pwindow[l]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, absDiff(Pwindow[l], old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;
@@ -445,7 +615,8 @@ int selectDiffsToRemove2(std::map<int,int> &sketch, double gamma, double logGamm
 
 
 
-int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+template <class SketchT>
+int selectDiffsToRemove(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
     
     double old_item = Pwindow[pos];
     int key, res;
@@ -466,7 +637,7 @@ int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma
             std::cout << ": choose left " << std::endl;
             #endif
 
-            key = getKeyFor(std::abs(old_item-Pwindow[l]), gamma, logGamma);
+            key = getSketchKey(sketch, std::abs(old_item-Pwindow[l]), gamma, logGamma);
             res = decreaseBinCount(key, sketch);
             if (res == 1) {
                 ++count;    //PARTIAL mode
@@ -479,7 +650,7 @@ int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma
             std::cout << ": choose right " << std::endl;
             #endif
             
-            key = getKeyFor(std::abs(Pwindow[r]-old_item), gamma, logGamma);
+            key = getSketchKey(sketch, std::abs(Pwindow[r]-old_item), gamma, logGamma);
             res = decreaseBinCount(key, sketch);
             if (res == 1) {
                 ++count;
@@ -495,7 +666,7 @@ int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma
 
             while ((r<s) && (count<ndiffs)) {
 
-                key = getKeyFor(std::abs(Pwindow[r]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, std::abs(Pwindow[r]-old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;
@@ -512,7 +683,7 @@ int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma
 
             while ((l>=0) && (count<ndiffs)) {
 
-                key = getKeyFor(std::abs(Pwindow[l]-old_item), gamma, logGamma);
+                key = getSketchKey(sketch, std::abs(Pwindow[l]-old_item), gamma, logGamma);
                 res = decreaseBinCount(key, sketch);
                 if (res == 1) {
                     ++count;
@@ -529,7 +700,8 @@ int selectDiffsToRemove(std::map<int,int> &sketch, double gamma, double logGamma
 
 
 
-int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+template <class SketchT>
+int selectDiffsToAdd(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
 
     double new_item = Pwindow[pos];
     
@@ -550,8 +722,8 @@ int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, i
             std::cout << ": choose left" << std::endl;
             #endif
             
-            key = getKeyFor(std::abs(new_item-Pwindow[l]), gamma, logGamma);
-            sketch[key] += 1;
+            key = getSketchKey(sketch, std::abs(new_item-Pwindow[l]), gamma, logGamma);
+            incrementBinCount(key, sketch);
             ++count;
             --l;
         }
@@ -561,8 +733,8 @@ int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, i
             std::cout << ": choose right" << std::endl;
             #endif
 
-            key = getKeyFor(std::abs(Pwindow[r]-new_item), gamma, logGamma);
-            sketch[key] += 1;
+            key = getSketchKey(sketch, std::abs(Pwindow[r]-new_item), gamma, logGamma);
+            incrementBinCount(key, sketch);
             ++count;
             ++r;
         } 
@@ -575,8 +747,8 @@ int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, i
 
             for(int i = r; i < s; ++i) {
 
-                key = getKeyFor(std::abs(Pwindow[i]-new_item), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, std::abs(Pwindow[i]-new_item), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 if (count == ndiffs){
                     return count;
@@ -592,8 +764,8 @@ int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, i
 
            for(int i = l; i >= 0; --i) {
 
-                key = getKeyFor(std::abs(new_item-Pwindow[i]), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, std::abs(new_item-Pwindow[i]), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 if (count == ndiffs){
                     return count;
@@ -609,9 +781,10 @@ int selectDiffsToAdd(std::map<int,int> &sketch, double gamma, double logGamma, i
 
 
 
-int selectDiffsToAdd2(std::map<int,int> &sketch, double gamma, double logGamma, int pos, int ndiffs, double *Pwindow, int s) {
+template <class SketchT, class T>
+int selectDiffsToAdd2(SketchT &sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
 
-    double new_item = Pwindow[pos];
+    T new_item = Pwindow[pos];
     
     int r = pos + 1;
     int l = pos - 1;
@@ -621,31 +794,31 @@ int selectDiffsToAdd2(std::map<int,int> &sketch, double gamma, double logGamma,
     while (count < ndiffs) { 
         
         if (r<s && l>=0) {
-            double d1 = std::abs(Pwindow[l]-new_item); 
-            double d2 = std::abs(new_item - Pwindow[r]);
+            double d1 = absDiff(Pwindow[l], new_item); 
+            double d2 = absDiff(new_item, Pwindow[r]);
             
             if (d1<=d2){
-                key = getKeyFor(d1, gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, d1, gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 --l;
             } else {
-                key = getKeyFor(d2, gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, d2, gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 ++r;
             }//fi smallest diff
         } else {
             while (r<s && count < ndiffs){
-                key = getKeyFor(std::abs(Pwindow[r]-new_item), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, absDiff(Pwindow[r], new_item), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 ++r;
             }//wend r
 
             while (l>=0 && count < ndiffs){
-                key = getKeyFor(std::abs(new_item-Pwindow[l]), gamma, logGamma);
-                sketch[key] += 1;
+                key = getSketchKey(sketch, absDiff(new_item, Pwindow[l]), gamma, logGamma);
+                incrementBinCount(key, sketch);
                 ++count;
                 --l;
             }//wend l
@@ -660,7 +833,29 @@ int selectDiffsToAdd2(std::map<int,int> &sketch, double gamma, double logGamma,
 
 
 
-int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::map<int,int>& Sketch, double gamma, double logGamma, int ndiffs) {
+template <class SketchT, class T>
+static inline int removeDiffs(NearestSelection, SketchT& Sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
+    return selectDiffsToRemove2(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
+}
+
+template <class SketchT, class T>
+static inline int addDiffs(NearestSelection, SketchT& Sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
+    return selectDiffsToAdd2(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
+}
+
+template <class SketchT, class T>
+static inline int removeDiffs(UniformSelection, SketchT& Sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
+    return uniformRemove(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
+}
+
+template <class SketchT, class T>
+static inline int addDiffs(UniformSelection, SketchT& Sketch, double gamma, double logGamma, int pos, int ndiffs, T *Pwindow, int s) {
+    return uniformAdd(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
+}
+
+
+template <class SelectionT, class SketchT, class T>
+int updateSketch(T old_item, T new_item, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma, int ndiffs) {
     
     int pos = -1;               
     int population = 0;         
@@ -681,11 +876,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
             exit(1);
         }
 
-        #ifndef UNIFORM 
-            removed = selectDiffsToRemove2(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
-        #else
-            removed = uniformRemove(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
-        #endif
+        removed = removeDiffs(SelectionT(), Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
        
         for ( int p = pos; p < s-1; ++p) {
 
@@ -694,11 +885,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
             } else {
                 Pwindow[p] = new_item;
                 
-                #ifndef UNIFORM 
-                    added = selectDiffsToAdd2(Sketch, gamma, logGamma, p, removed, Pwindow, s);
-                #else
-                    added = uniformAdd(Sketch, gamma, logGamma, p, removed, Pwindow, s);
-                #endif
+                added = addDiffs(SelectionT(), Sketch, gamma, logGamma, p, removed, Pwindow, s);
 
                 return (added-removed); 
             }//fi check
@@ -707,11 +894,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
 
         Pwindow[s-1] = new_item;
 
-        #ifndef UNIFORM 
-            added = selectDiffsToAdd2(Sketch, gamma, logGamma, s-1, removed, Pwindow, s);
-        #else
-            added = uniformAdd(Sketch, gamma, logGamma, s-1, removed, Pwindow, s);
-        #endif
+        added = addDiffs(SelectionT(), Sketch, gamma, logGamma, s-1, removed, Pwindow, s);
 
         return (added-removed); 
     }// fi (old_item < new_item)
@@ -724,11 +907,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
         }
 
         
-        #ifndef UNIFORM 
-           removed = selectDiffsToRemove2(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
-        #else
-            removed = uniformRemove(Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
-        #endif
+        removed = removeDiffs(SelectionT(), Sketch, gamma, logGamma, pos, ndiffs, Pwindow, s);
 
         for (int p = pos; p > 0; --p) {
 
@@ -738,11 +917,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
                 
                 Pwindow[p] = new_item;
                 
-                #ifndef UNIFORM 
-                    added = selectDiffsToAdd2(Sketch, gamma, logGamma, p, removed, Pwindow, s);
-                #else
-                    added = uniformAdd(Sketch, gamma, logGamma, p, removed, Pwindow, s);
-                #endif
+                added = addDiffs(SelectionT(), Sketch, gamma, logGamma, p, removed, Pwindow, s);
 
                 return (added-removed); 
             }//fi check
@@ -750,11 +925,7 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
 
         Pwindow[0] = new_item;
 
-        #ifndef UNIFORM 
-            added = selectDiffsToAdd2(Sketch, gamma, logGamma, 0, removed, Pwindow, s);
-        #else
-            added = uniformAdd(Sketch, gamma, logGamma, 0, removed, Pwindow, s);
-        #endif
+        added = addDiffs(SelectionT(), Sketch, gamma, logGamma, 0, removed, Pwindow, s);
 
         return (added-removed); 
     }// fi (new_item < old_item)  
@@ -764,28 +935,24 @@ int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::
 
 //********************************************************************************************
 
-int computeDiffs(double new_item, double old_item, double Pitem, double gamma, double logG, std::map<int,int>&sketch) {
+template <class SketchT>
+inline int computeDiffs(double new_item, double old_item, double Pitem, double gamma, double logG, SketchT& sketch) {
     
     int added = 0;
     int removed = 0;
 
     double diffA = std::abs(Pitem - new_item); 
-    int keyA = getKeyFor(diffA, gamma, logG);
+    int keyA = getSketchKey(sketch, diffA, gamma, logG);
                 
     double diffR = std::abs(Pitem - old_item);
-    int keyR = getKeyFor(diffR, gamma, logG);
+    int keyR = getSketchKey(sketch, diffR, gamma, logG);
             
     if (keyA != keyR) {
-        sketch[keyA] += 1;
+        incrementBinCount(keyA, sketch);
         ++added;
 
-        std::map<int,int>::iterator it = sketch.find(keyR);
-        if (it != sketch.end()) {
+        if (decreaseBinCount(keyR, sketch) == 1) {
             ++removed;
-            it->second -= 1;
-            if (!it->second){
-                sketch.erase(it);
-            }
         } else {
             std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
             exit(1);
@@ -797,7 +964,8 @@ int computeDiffs(double new_item, double old_item, double Pitem, double gamma, d
 
 
 
-void updateSynopsis(double old_item, double new_item, double *Pwindow, int s, std::map<int,int>& Sketch, double gamma, double logGamma) {
+template <class SketchT>
+void updateSynopsis(double old_item, double new_item, double *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma) {
     
     int posA = -1;                       
     int posR = -1;                       
@@ -946,3 +1114,223 @@ void updateSynopsis(double old_item, double new_item, double *Pwindow, int s, st
 
     }//fi 
 } 
+
+
+
+//********************************************************************************************
+
+// Same sketch update as updateSynopsis(), computed on the ring buffer instead of the
+// sorted window: the pairs of window[pos] = new_item with every other element replace
+// those of old_item. The key kernel runs on plain contiguous ranges and hands back only
+// the pairs whose bucket changes; the sorted window is maintained apart (updateSortedWindow).
+template <class SketchT, class T>
+void updateSynopsisRing(T old_item, T new_item, T *window, int pos, int s, SketchT& Sketch, double gamma, double logGamma) {
+
+    int keysA[KERNEL_CHUNK + KERNEL_PAD];
+    int keysR[KERNEL_CHUNK + KERNEL_PAD];
+
+    int ranges[2][2] = { {0, pos}, {pos+1, s} };
+    for (int r = 0; r < 2; ++r) {
+        for (int from = ranges[r][0]; from < ranges[r][1]; from += KERNEL_CHUNK) {
+            
+            int to = std::min(from + KERNEL_CHUNK, ranges[r][1]);
+            int n = getSketchKeyDeltas(Sketch, window, from, to, new_item, old_item, gamma, logGamma, keysA, keysR);
+            
+            for (int i = 0; i < n; ++i) {
+                incrementBinCount(keysA[i], Sketch);
+                if (decreaseBinCount(keysR[i], Sketch) != 1) {
+                    std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
+                    exit(1);
+                }
+            }//for i
+        }//for chunk
+    }//for r
+}
+
+
+
+//********************************************************************************************
+
+// Both sorted windows, the flat array and the blocked one, are read through these
+template <class T>
+static inline T windowAt(T *Pwindow, int j) {
+    return Pwindow[j];
+}
+
+static inline double windowAt(SortedWindow& Pwindow, int j) {
+    return sortedAt(Pwindow, j);
+}
+
+
+
+// Adds weight (+1/-1) to the buckets of |Pwindow[pos+dir*t] - x| for t = 1..last.
+// Those differences are sorted, so the keys come in runs: each run is found by
+// galloping then bisecting on the key, and its length is added in one step.
+// Costs O(B log s) key computations instead of O(s), B being the buckets touched.
+template <class SketchT, class WindowT, class T>
+static void addKeyRuns(T x, int pos, int dir, int last, WindowT& Pwindow, SketchT& Sketch, double gamma, double logGamma, int weight) {
+
+    int t = 1;
+    while (t <= last) {
+
+        int key = getDiffKey(windowAt(Pwindow, pos + dir*t), x, Sketch, gamma, logGamma);
+
+        // [lo] is known to be in the run, [hi] past it (or past the range)
+        int lo = t;
+        int hi = t + 1;
+        int step = 1;
+        while (hi <= last && getDiffKey(windowAt(Pwindow, pos + dir*hi), x, Sketch, gamma, logGamma) == key) {
+            lo = hi;
+            step <<= 1;
+            hi = t + step;
+        }//wend gallop
+        hi = std::min(hi, last + 1);
+
+        while (hi - lo > 1) {
+            int mid = lo + (hi - lo)/2;
+            if (getDiffKey(windowAt(Pwindow, pos + dir*mid), x, Sketch, gamma, logGamma) == key) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }//wend bisect
+
+        if (weight > 0) {
+            incrementBinCount(key, hi - t, Sketch);
+        } else if (decreaseBinCount(key, hi - t, Sketch) != 1) {
+            std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
+            exit(1);
+        }
+        t = hi;
+    }//wend t
+}
+
+
+
+// pos is any copy of x in the window: the others give zero differences
+template <class SketchT, class WindowT, class T>
+static void addPairsOf(T x, int pos, WindowT& Pwindow, int s, SketchT& Sketch, double gamma, double logGamma, int weight) {
+
+    addKeyRuns(x, pos, +1, s - 1 - pos, Pwindow, Sketch, gamma, logGamma, weight);
+    addKeyRuns(x, pos, -1, pos, Pwindow, Sketch, gamma, logGamma, weight);
+}
+
+
+
+// Same sketch update as updateSynopsis(), counted by bucket ranges on the sorted window:
+// the s-1 pairs of old_item are removed, the window updated and those of new_item added,
+// each as a few runs of equal keys. Pays off once s is large w.r.t. the sketch size.
+template <class SketchT, class T>
+void updateSynopsisRanges(T old_item, T new_item, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma) {
+
+    addPairsOf(old_item, bsearch(old_item, Pwindow, s), Pwindow, s, Sketch, gamma, logGamma, -1);
+    updateSortedWindow(Pwindow, s, new_item, old_item);
+    addPairsOf(new_item, bsearch(new_item, Pwindow, s), Pwindow, s, Sketch, gamma, logGamma, +1);
+}
+
+
+template <class SketchT>
+void updateSynopsisRanges(double old_item, double new_item, SortedWindow& Pwindow, SketchT& Sketch, double gamma, double logGamma) {
+
+    addPairsOf(old_item, rankOfSorted(Pwindow, old_item), Pwindow, Pwindow.size, Sketch, gamma, logGamma, -1);
+    eraseSorted(Pwindow, old_item);
+    insertSorted(Pwindow, new_item);
+    addPairsOf(new_item, rankOfSorted(Pwindow, new_item), Pwindow, Pwindow.size, Sketch, gamma, logGamma, +1);
+}
+
+
+
+// Warm-up counterpart of fillSketch(): inserts item and adds its pairs with the values
+// already in the window, returning their number
+template <class SketchT>
+int fillSketchRanges(double item, SortedWindow& Pwindow, SketchT& Sketch, double gamma, double logGamma) {
+
+    insertSorted(Pwindow, item);
+    addPairsOf(item, rankOfSorted(Pwindow, item), Pwindow, Pwindow.size, Sketch, gamma, logGamma, +1);
+    return Pwindow.size - 1;
+}
+
+
+
+//********************************************************************************************
+
+// Same sketch update as updateSynopsis(), on the run-length window: the pairs of old_item
+// and new_item with the other s-1 items are moved once per distinct value v, weighted by
+// its copies. The run of old_item (or new_item) itself gives the zero differences: its
+// count goes to or leaves the -MIN_KEY bucket in one step.
+template <class SketchT, class T>
+void updateSynopsisRuns(T old_item, T new_item, RunWindow<T>& Pwindow, SketchT& Sketch, double gamma, double logGamma) {
+
+    eraseRun(Pwindow, old_item);
+
+    for (int r = 0; r < Pwindow.runs; ++r) {
+
+        int keyA = getDiffKey(Pwindow.values[r], new_item, Sketch, gamma, logGamma);
+        int keyR = getDiffKey(Pwindow.values[r], old_item, Sketch, gamma, logGamma);
+
+        if (keyA != keyR) {
+            incrementBinCount(keyA, Pwindow.counts[r], Sketch);
+            if (decreaseBinCount(keyR, Pwindow.counts[r], Sketch) != 1) {
+                std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
+                exit(1);
+            }
+        }//fi
+    }//for r
+
+    insertRun(Pwindow, new_item);
+}
+
+
+// Warm-up counterpart of updateSynopsisRuns()
+template <class SketchT, class T>
+int fillSketchRuns(T item, RunWindow<T>& Pwindow, SketchT& Sketch, double gamma, double logGamma) {
+
+    for (int r = 0; r < Pwindow.runs; ++r) {
+        incrementBinCount(getDiffKey(Pwindow.values[r], item, Sketch, gamma, logGamma), Pwindow.counts[r], Sketch);
+    }//for r
+
+    insertRun(Pwindow, item);
+    return Pwindow.size - 1;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Instantiations
+
+#define INSTANTIATE_SKETCH_OPS(SketchT) \
+    template void logQuantiles<SketchT>(FILE *, SketchT&, int, double, double *, int); \
+    template int performCollapse<SketchT>(SketchT&, int, double *, double *, double *, int *); \
+    template void updateSynopsis<SketchT>(double, double, double *, int, SketchT&, double, double); \
+    template void updateSynopsisRanges<SketchT>(double, double, SortedWindow&, SketchT&, double, double); \
+    template int fillSketchRanges<SketchT>(double, SortedWindow&, SketchT&, double, double);
+
+INSTANTIATE_SKETCH_OPS(MapSketch)
+INSTANTIATE_SKETCH_OPS(DenseSketch)
+INSTANTIATE_SKETCH_OPS(FenwickSketch)
+INSTANTIATE_SKETCH_OPS(SketchPyramid)
+INSTANTIATE_SKETCH_OPS(LogLinearSketch)
+
+#define INSTANTIATE_WINDOW_SKETCH_OPS(SketchT, T) \
+    template int fillSketch<SketchT, T>(int, T *, double, double, SketchT&); \
+    template int updateSketch<NearestSelection, SketchT, T>(T, T, T *, int, SketchT&, double, double, int); \
+    template int updateSketch<UniformSelection, SketchT, T>(T, T, T *, int, SketchT&, double, double, int); \
+    template void updateSynopsisRing<SketchT, T>(T, T, T *, int, int, SketchT&, double, double); \
+    template void updateSynopsisRanges<SketchT, T>(T, T, T *, int, SketchT&, double, double); \
+    template void updateSynopsisRuns<SketchT, T>(T, T, RunWindow<T>&, SketchT&, double, double); \
+    template int fillSketchRuns<SketchT, T>(T, RunWindow<T>&, SketchT&, double, double);
+
+INSTANTIATE_WINDOW_SKETCH_OPS(MapSketch, double)
+INSTANTIATE_WINDOW_SKETCH_OPS(DenseSketch, double)
+INSTANTIATE_WINDOW_SKETCH_OPS(FenwickSketch, double)
+INSTANTIATE_WINDOW_SKETCH_OPS(SketchPyramid, double)
+INSTANTIATE_WINDOW_SKETCH_OPS(LogLinearSketch, double)
+INSTANTIATE_WINDOW_SKETCH_OPS(MapSketch, float)
+INSTANTIATE_WINDOW_SKETCH_OPS(DenseSketch, float)
+INSTANTIATE_WINDOW_SKETCH_OPS(FenwickSketch, float)
+INSTANTIATE_WINDOW_SKETCH_OPS(SketchPyramid, float)
+INSTANTIATE_WINDOW_SKETCH_OPS(LogLinearSketch, float)
+INSTANTIATE_WINDOW_SKETCH_OPS(MapSketch, int)
+INSTANTIATE_WINDOW_SKETCH_OPS(DenseSketch, int)
+INSTANTIATE_WINDOW_SKETCH_OPS(FenwickSketch, int)
+INSTANTIATE_WINDOW_SKETCH_OPS(SketchPyramid, int)
+INSTANTIATE_WINDOW_SKETCH_OPS(LogLinearSketch, int)
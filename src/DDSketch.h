@@ -20,15 +20,37 @@
 
 #include "Utility.h"
 #include "IIS.h"
+#include "NodePool.h"
+#include "SortedWindow.h"
+#include "RunWindow.h"
+#include "IntKey.h"
+#include "WindowKernel.h"
+
+#include <numeric>
 
 const int MIN_KEY = pow(2,30);                  
 
+// Differences up to NULLBOUND go to the bucket for 0 (key -MIN_KEY). The bound is
+// gamma^-MIN_KEY, which underflows to 0 for every alpha >= MIN_ALPHA.
+const double NULLBOUND = 0.0;
+
+typedef long BinCount;          // bucket counts and populations: s(s-1)/2 overflows an int past s = 65536
+
+// std::map sketch; its nodes come from the NodePool given to the allocator, if any
+typedef std::map<int, BinCount, std::less<int>, PoolAllocator<std::pair<const int, BinCount> > > MapSketch;
+
 
 //****** ****** ****** ****** ****** ************ Utility functions
 
 
 int getKeyFor(double value, double gamma, double logG);
 
+int getKeyForLog10(double value, double gamma, double logG);
+
+// Number of normal doubles, near bucket boundaries and sampled, whose getKeyFor() and
+// getKeyForLog10() keys differ (see make verify)
+int verifyKeyFor(double gamma, double logG);
+
 
 double getCurrentAlpha(double alpha);
 
@@ -39,38 +61,169 @@ double getCurrentGamma(double alpha);
 double getCurrentLogG(double gamma);
 
 
-double getQuantileFraction(int kth, int I);
+double getQuantileFraction(long kth, long I);
+
+
+void debugSketch(MapSketch& mySketch);
+
+int getSketchBuckets(MapSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity);
+
+
+
+double estimateQ(MapSketch& Sketch, double q, double gamma, long n);
+
+double estimator(MapSketch& mySketch, double q, double gamma);
+
+template <class SketchT>
+void logQuantiles(FILE *fp, SketchT& mySketch, int collapses, double gamma, double *exactDiffs, int len);
+
+
+
+//****** ****** ****** ****** ****** ************ Bin access
+//
+// Every sketch type (std::map, DenseSketch, ...) is a backend selected by the template
+// parameter SketchT of the generic functions, which are written only in terms of:
+//   incrementBinCount / decreaseBinCount (by one or by a count), getSketchSize, getSketchPopulation,
+//   collapseUniformly, estimateQ / estimator (rank queries), debugSketch,
+//   getSketchBuckets (the value and count of every non-empty bucket, ascending, or -1 if
+//   there are more than capacity of them)
+// and of the bucketing hooks below, whose defaults are the DDSketch logarithmic keys.
+// decreaseBinCount returns -1, leaving the sketch as it is, when the bucket holds fewer
+// differences: a partial update skips them, the full ones report the error and exit.
+
+inline void incrementBinCount(int key, MapSketch& sketch) {
+    sketch[key] += 1;
+}
+
+int decreaseBinCount(int key, MapSketch& sketch);
+
+inline void incrementBinCount(int key, BinCount count, MapSketch& sketch) {
+    sketch[key] += count;
+}
+
+int decreaseBinCount(int key, BinCount count, MapSketch& sketch);
 
+inline int getSketchSize(MapSketch& sketch) {
+    return sketch.size();
+}
 
-void debugSketch(std::map< int, int>& mySketch);
+inline BinCount getSketchPopulation(MapSketch& sketch) {
+    return std::accumulate( sketch.begin(), sketch.end(), (BinCount)0, []( BinCount acc, std::pair<int, BinCount> p ) { return ( acc + p.second ); } );
+}
 
 
 
-double estimateQ(std::map<int, int>& Sketch, double q, double gamma, int n);
+// Resolution the keys are computed at: the current one, unless the sketch records a finer one
+template <class SketchT>
+inline double getKeyGamma(SketchT& sketch, double gamma) {
+    return gamma;
+}
 
-void logQuantiles(FILE *fp, std::map< int,int>&mySketch, int collapses, double gamma, double *exactDiffs, int len);
+template <class SketchT>
+inline double getKeyLogG(SketchT& sketch, double logG) {
+    return logG;
+}
+
+
+// Key of a difference, of an exact integer difference, and of the pairs of a window
+// (see computeKeyDeltas): a sketch type with its own bucketing overloads all three
+template <class SketchT>
+inline int getSketchKey(SketchT& sketch, double value, double gamma, double logG) {
+    return getKeyFor(value, gamma, logG);
+}
+
+template <class SketchT>
+inline int getIntSketchKey(SketchT& sketch, uint32_t diff, double gamma, double logG) {
+    return intKeyFor(diff, getIntKeyTable(gamma, logG), gamma, logG);
+}
+
+template <class SketchT, class T>
+inline int getSketchKeyDeltas(SketchT& sketch, const T *window, int from, int to, T new_item, T old_item, double gamma, double logG, int *keysA, int *keysR) {
+    return computeKeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+}
+
+// |a - b| as the double the partial updates key and compare
+template <class T>
+inline double absDiff(T a, T b) {
+    return std::abs(a - b);
+}
+
+inline double absDiff(int a, int b) {
+    return intDiff(a, b);
+}
+
+
+// Whether the non-empty buckets and the keys minKey..maxKey (none if minKey > maxKey) span
+// fewer than maxSpan keys: a sketch whose memory follows the span of its keys overloads it
+// (see DenseSketch.h), and the engine collapses until the keys of a new item fit
+template <class SketchT>
+inline int fitSketchKeys(SketchT& sketch, int minKey, int maxKey, int maxSpan) {
+    return 1;
+}
 
 
 
 //****** ****** ****** ****** ****** ************ Uniform Collapse
 
-int performCollapse(std::map<int, int>& Sketch, int sketchBound, double *currentAlpha, double *currentGamma, double *currentLogG, int *SketchSize);
+void collapseUniformly(MapSketch& mySketch);
+
+template <class SketchT>
+int performCollapse(SketchT& Sketch, int sketchBound, double *currentAlpha, double *currentGamma, double *currentLogG, int *SketchSize);
 
 //****** ****** ****** ****** ****** ************ Sketch Filling (with s(s-1)/2 differences)
 
-int fillSketch(int pos, double *window, double gamma, double LogG, std::map<int, int>& Sketch);
+// The functions taking a window of T are defined for T = double, float and int
+
+template <class SketchT, class T>
+int fillSketch(int pos, T *window, double gamma, double LogG, SketchT& Sketch);
 
 
 //****** ****** ****** ****** ****** ************ Sketch Updating
 
+// Difference selection policies: FullSelection refreshes all the s-1 differences of an item
+// through the window engines; updateSketch() refreshes only ndiffs of them, those with its
+// nearest items in the sorted window or one every (s-1)/ndiffs items
+typedef struct FullSelection {
+    static const char *name() { return "full"; }
+} FullSelection;
+
+typedef struct NearestSelection {
+    static const char *name() { return "nearest"; }
+} NearestSelection;
+
+typedef struct UniformSelection {
+    static const char *name() { return "uniform"; }
+} UniformSelection;
+
+
+// Keeps Pwindow sorted; returns the change of the sketch population (added - removed)
+template <class SelectionT, class SketchT, class T>
+int updateSketch(T old_item, T new_item, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma, int ndiffs);
+
+
+template <class SketchT>
+void updateSynopsis(double old_item, double new_item, double *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma);
+
+
+template <class SketchT, class T>
+void updateSynopsisRanges(T old_item, T new_item, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma);
+
+template <class SketchT>
+void updateSynopsisRanges(double old_item, double new_item, SortedWindow& Pwindow, SketchT& Sketch, double gamma, double logGamma);
+
+template <class SketchT>
+int fillSketchRanges(double item, SortedWindow& Pwindow, SketchT& Sketch, double gamma, double logGamma);
 
-int updateSketch(double old_item, double new_item, double *Pwindow, int s, std::map<int,int>& Sketch, double gamma, double logGamma, int ndiffs);
 
+template <class SketchT, class T>
+void updateSynopsisRuns(T old_item, T new_item, RunWindow<T>& Pwindow, SketchT& Sketch, double gamma, double logGamma);
 
-int decreaseBinCount(int key, std::map<int, int>& sketch);
+template <class SketchT, class T>
+int fillSketchRuns(T item, RunWindow<T>& Pwindow, SketchT& Sketch, double gamma, double logGamma);
 
 
-void updateSynopsis(double old_item, double new_item, double *Pwindow, int s, std::map<int,int>& Sketch, double gamma, double logGamma);
+template <class SketchT, class T>
+void updateSynopsisRing(T old_item, T new_item, T *window, int pos, int s, SketchT& Sketch, double gamma, double logGamma);
 
 
 #endif //__DDSKETCH_H__
@@ -0,0 +1,339 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "DenseSketch.h"
+#include <cstring>
+#include <stdlib.h>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Memory management
+
+void initDenseSketch(DenseSketch *sketch, int capacity) {
+
+    sketch->counts = (BinCount *)calloc(capacity, sizeof(BinCount));
+    if (sketch->counts == NULL) {
+        std::cerr << "ERROR: unable to allocate the dense sketch" << std::endl;
+        exit(1);
+    }
+
+    sketch->capacity = capacity;
+    sketch->offset = -capacity/2;
+    sketch->lo = capacity;
+    sketch->hi = -1;
+    sketch->zeroCount = 0;
+    sketch->bins = 0;
+
+    sketch->cursor = -1;
+    sketch->below = 0;
+}
+
+
+void destroyDenseSketch(DenseSketch *sketch) {
+
+    if (sketch && sketch->counts) {
+        free(sketch->counts);
+        sketch->counts = NULL;
+    }
+}
+
+
+// Moves the used range of counts[] to start at from
+static void moveDenseSketch(DenseSketch& sketch, int from) {
+
+    int used = sketch.hi - sketch.lo + 1;
+    memmove(&sketch.counts[from], &sketch.counts[sketch.lo], used*sizeof(BinCount));
+    if (from > sketch.lo) {
+        memset(&sketch.counts[sketch.lo], 0, std::min(from - sketch.lo, used)*sizeof(BinCount));
+    } else {
+        int tail = std::max(from + used, sketch.lo);
+        memset(&sketch.counts[tail], 0, (sketch.hi + 1 - tail)*sizeof(BinCount));
+    }
+}
+
+
+// Offset, cursor and used range after the buckets moved to start at from
+static void rebaseDenseSketch(DenseSketch& sketch, int offset, int from) {
+
+    int used = sketch.hi - sketch.lo + 1;
+    if (sketch.cursor != -1) {
+        // only empty buckets lie past the used range, clamping keeps the count below
+        int cursor = sketch.cursor + sketch.offset - offset;
+        sketch.cursor = std::min(std::max(cursor, 0), from + used);
+    }
+
+    sketch.offset = offset;
+    sketch.lo = from;
+    sketch.hi = from + used - 1;
+}
+
+
+void growDenseSketch(DenseSketch& sketch, int key) {
+
+    if (sketch.lo > sketch.hi) {
+        // empty: just move the window of keys around the new one
+        sketch.offset = key - sketch.capacity/2;
+        sketch.lo = sketch.capacity;
+        sketch.hi = -1;
+        sketch.cursor = -1;
+        sketch.below = 0;
+        return;
+    }
+
+    int minKey = std::min(key, sketch.offset + sketch.lo);
+    int maxKey = std::max(key, sketch.offset + sketch.hi);
+    long span = (long)maxKey - minKey + 1;
+    if (span > DENSE_MAX_CAPACITY/2) {
+        std::cerr << "ERROR: the dense sketch keys span more than " << DENSE_MAX_CAPACITY/2 << " buckets" << std::endl;
+        exit(1);
+    }
+
+    int capacity = sketch.capacity;
+    while (capacity < 2*span) {
+        capacity *= 2;
+    }//wend
+
+    int offset = minKey - (capacity - span)/2;
+    int used = sketch.hi - sketch.lo + 1;
+    int from = sketch.offset + sketch.lo - offset;
+
+    if (capacity == sketch.capacity) {
+        // recentre in place
+        moveDenseSketch(sketch, from);
+    } else {
+        BinCount *counts = (BinCount *)calloc(capacity, sizeof(BinCount));
+        if (counts == NULL) {
+            std::cerr << "ERROR: unable to grow the dense sketch to " << capacity << " buckets" << std::endl;
+            exit(1);
+        }
+        memcpy(&counts[from], &sketch.counts[sketch.lo], used*sizeof(BinCount));
+        free(sketch.counts);
+        sketch.counts = counts;
+        sketch.capacity = capacity;
+    }//fi capacity
+
+    rebaseDenseSketch(sketch, offset, from);
+}
+
+
+int fitDenseSketch(DenseSketch& sketch, int minKey, int maxKey) {
+
+    if (sketch.lo > sketch.hi) {
+        if (maxKey - minKey >= sketch.capacity) {
+            return 0;
+        }
+        sketch.offset = minKey - (sketch.capacity - (maxKey - minKey + 1))/2;
+        sketch.lo = sketch.capacity;
+        sketch.hi = -1;
+        sketch.cursor = -1;
+        sketch.below = 0;
+        return 1;
+    }
+
+    if (minKey - sketch.offset >= 0 && maxKey - sketch.offset < sketch.capacity) {
+        return 1;
+    }
+
+    minKey = std::min(minKey, sketch.offset + sketch.lo);
+    maxKey = std::max(maxKey, sketch.offset + sketch.hi);
+    int span = maxKey - minKey + 1;
+    if (span > sketch.capacity) {
+        return 0;
+    }
+
+    int offset = minKey - (sketch.capacity - span)/2;
+    int from = sketch.offset + sketch.lo - offset;
+    moveDenseSketch(sketch, from);
+    rebaseDenseSketch(sketch, offset, from);
+    return 1;
+}
+
+
+void copyDenseSketch(DenseSketch& dest, DenseSketch& src) {
+
+    if (dest.capacity != src.capacity) {
+        free(dest.counts);
+        dest.counts = (BinCount *)malloc(src.capacity*sizeof(BinCount));
+        if (dest.counts == NULL) {
+            std::cerr << "ERROR: unable to allocate the dense sketch" << std::endl;
+            exit(1);
+        }
+    }
+
+    BinCount *counts = dest.counts;
+    memcpy(counts, src.counts, src.capacity*sizeof(BinCount));
+    dest = src;
+    dest.counts = counts;
+}
+
+
+BinCount getSketchPopulation(DenseSketch& sketch) {
+
+    BinCount population = sketch.zeroCount;
+    for (int i = sketch.lo; i <= sketch.hi; ++i) {
+        population += sketch.counts[i];
+    }//for
+    return population;
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Queries
+
+double estimator(DenseSketch& mySketch, double q, double gamma) {
+
+    int i = -MIN_KEY;
+    double sum = mySketch.zeroCount;
+
+    int idx = mySketch.lo;
+    while (sum <= q && idx <= mySketch.hi) {
+        if (mySketch.counts[idx]) {
+            i = mySketch.offset + idx;
+            sum += mySketch.counts[idx];
+        }
+        ++idx;
+    }//wend
+
+    //Return the estimation x_q of bucket with key i
+    return (2.0 * pow(gamma,i))/(gamma+1.0);
+}
+
+
+// Moves the rank cursor to the first bucket whose cumulative count exceeds
+// fraction, i.e. the bucket estimator() would stop on
+int seekRankCursor(DenseSketch& sketch, double fraction) {
+
+    while (sketch.below > fraction && sketch.cursor != -1) {
+        sketch.cursor = std::min(sketch.cursor-1, sketch.hi);
+        if (sketch.cursor < sketch.lo) {
+            sketch.cursor = -1;
+            sketch.below = 0;
+        } else {
+            sketch.below -= sketch.counts[sketch.cursor];
+        }
+    }//wend down
+
+    BinCount count = (sketch.cursor == -1) ? sketch.zeroCount : sketch.counts[sketch.cursor];
+    while (sketch.below + count <= fraction && sketch.cursor < sketch.hi) {
+        sketch.below += count;
+        sketch.cursor = (sketch.cursor < sketch.lo) ? sketch.lo : sketch.cursor+1;
+        count = sketch.counts[sketch.cursor];
+    }//wend up
+
+    if (sketch.cursor == -1 || sketch.cursor > sketch.hi) {
+        // zero bucket, or beyond the population: the last bucket answers
+        return (sketch.cursor == -1 || sketch.lo > sketch.hi) ? -MIN_KEY : sketch.offset + sketch.hi;
+    }
+    return sketch.offset + sketch.cursor;
+}
+
+
+double estimateQ(DenseSketch& Sketch, double q, double gamma, long n) {
+
+    double fraction = q*(n-1);
+    int i = seekRankCursor(Sketch, fraction);
+    double estimate = (2.0 * pow(gamma,i))/(gamma+1.0);
+
+    #ifdef DEBUG
+        std::cout << "Quantile: " << estimate << ", population " << n << ", fraction " << fraction<< std::endl;
+    #endif
+
+    return estimate;
+}
+
+
+void debugSketch(DenseSketch& mySketch) {
+
+    fprintf(stdout,"\nSketch is : \n\t Key \t Count\n");
+
+    int loop= 1;
+    if (mySketch.zeroCount) {
+        fprintf(stdout,"%d) \t%+12d, \t%ld\n", loop++, -MIN_KEY, mySketch.zeroCount);
+    }
+    for (int i = mySketch.lo; i <= mySketch.hi; ++i) {
+        if (mySketch.counts[i]) {
+            fprintf(stdout,"%d) \t%+12d, \t%ld\n", loop++, mySketch.offset + i, mySketch.counts[i]);
+        }
+    }//for
+    fprintf(stdout,"Total differences contained in sketch %ld, over %d buckets\n\n", getSketchPopulation(mySketch), mySketch.bins);
+}
+
+
+int getSketchBuckets(DenseSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity) {
+
+    if (mySketch.bins > capacity) {
+        return -1;
+    }
+
+    int b = 0;
+    if (mySketch.zeroCount) {
+        values[b] = 0.0;
+        counts[b] = mySketch.zeroCount;
+        ++b;
+    }
+    for (int i = mySketch.lo; i <= mySketch.hi; ++i) {
+        if (mySketch.counts[i]) {
+            values[b] = (2.0 * pow(gamma,mySketch.offset + i))/(gamma+1.0);
+            counts[b] = mySketch.counts[i];
+            ++b;
+        }
+    }//for
+    return b;
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Uniform Collapse of the sketch
+
+// Bucket k moves to ceil(k/2). With the new offset ceil(offset/2) the destination
+// index never exceeds the source one, so a forward scan collapses in place.
+void collapseUniformly(DenseSketch& mySketch) {
+
+    int offset = -((-mySketch.offset) >> 1);
+
+    if (mySketch.lo > mySketch.hi) {
+        mySketch.offset = offset;
+        return;
+    }
+
+    int lo = -((-(mySketch.offset + mySketch.lo)) >> 1) - offset;
+    int hi = -((-(mySketch.offset + mySketch.hi)) >> 1) - offset;
+
+    int bins = (mySketch.zeroCount > 0);
+    for (int i = mySketch.lo; i <= mySketch.hi; ++i) {
+
+        BinCount count = mySketch.counts[i];
+        if (count) {
+            int j = -((-(mySketch.offset + i)) >> 1) - offset;
+            mySketch.counts[i] = 0;
+            if (!mySketch.counts[j]) {
+                ++bins;
+            }
+            mySketch.counts[j] += count;
+        }
+    }//for
+
+    mySketch.lo = lo;
+    mySketch.hi = hi;
+    mySketch.bins = bins;
+
+    if (mySketch.cursor != -1) {
+        mySketch.cursor = -((-(mySketch.offset + mySketch.cursor)) >> 1) - offset;
+        mySketch.below = mySketch.zeroCount;
+        for (int i = lo; i < mySketch.cursor; ++i) {
+            mySketch.below += mySketch.counts[i];
+        }//for
+    }
+    mySketch.offset = offset;
+}
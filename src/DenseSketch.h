@@ -0,0 +1,235 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __DENSESKETCH_H__
+#define __DENSESKETCH_H__
+
+#include "DDSketch.h"
+
+const int DENSE_INITIAL_CAPACITY = 1024;
+const int DENSE_MAX_CAPACITY = 1 << 24;     // buckets, i.e. 128 MB of counts
+const int DENSE_SPAN_FACTOR = 64;           // keys a sketch may span per bucket of its bound
+
+
+// Contiguous DDSketch: bucket k is stored in counts[k - offset].
+// The bucket for null differences (key -MIN_KEY) is kept apart in zeroCount.
+//
+// A rank cursor follows the bucket answering the last estimateQ(): every bin update
+// keeps the count below it current, so the next query only walks the few buckets
+// the target rank moved by. cursor == -1 stands for the zero bucket.
+typedef struct DenseSketch {
+    BinCount *counts;
+    int offset;         // key of counts[0]
+    int capacity;
+
+    int lo;             // all non-empty buckets lie in counts[lo..hi]
+    int hi;
+
+    BinCount zeroCount;
+    int bins;           // non-empty buckets, zero bucket included
+
+    int cursor;
+    BinCount below;     // differences in the buckets preceding the cursor
+} DenseSketch;
+
+
+
+void initDenseSketch(DenseSketch *sketch, int capacity);
+
+void destroyDenseSketch(DenseSketch *sketch);
+
+// Moves or doubles the buckets so that key fits; exits if the keys would span more
+// than DENSE_MAX_CAPACITY/2, which fitSketchKeys() keeps the engines below
+void growDenseSketch(DenseSketch& sketch, int key);
+
+// Recentres the buckets in place, without growing, so that keys minKey..maxKey fit;
+// returns 0 if they and the non-empty buckets span more than the capacity
+int fitDenseSketch(DenseSketch& sketch, int minKey, int maxKey);
+
+void copyDenseSketch(DenseSketch& dest, DenseSketch& src);
+
+
+
+//****** ****** ****** ****** ****** ************ Bin access
+
+inline void incrementBinCount(int key, DenseSketch& sketch) {
+
+    if (key == -MIN_KEY) {
+        if (!sketch.zeroCount++) {
+            ++sketch.bins;
+        }
+        sketch.below += (sketch.cursor != -1);
+        return;
+    }
+
+    int idx = key - sketch.offset;
+    if ((unsigned)idx >= (unsigned)sketch.capacity) {
+        growDenseSketch(sketch, key);
+        idx = key - sketch.offset;
+    }
+
+    sketch.below += (idx < sketch.cursor);
+    if (!sketch.counts[idx]++) {
+        ++sketch.bins;
+        if (idx < sketch.lo) sketch.lo = idx;
+        if (idx > sketch.hi) sketch.hi = idx;
+    }
+}
+
+
+inline int decreaseBinCount(int key, DenseSketch& sketch) {
+
+    BinCount *bin;
+    int isBelow;
+    if (key == -MIN_KEY) {
+        bin = &sketch.zeroCount;
+        isBelow = (sketch.cursor != -1);
+    } else {
+        int idx = key - sketch.offset;
+        bin = ((unsigned)idx < (unsigned)sketch.capacity) ? &sketch.counts[idx] : NULL;
+        isBelow = (idx < sketch.cursor);
+    }
+
+    if (bin == NULL || *bin == 0) {
+        return -1;
+    }
+
+    sketch.below -= isBelow;
+    if (!--(*bin)) {
+        --sketch.bins;
+        if (bin != &sketch.zeroCount) {
+            while (sketch.lo <= sketch.hi && !sketch.counts[sketch.lo]) ++sketch.lo;
+            if (sketch.lo > sketch.hi) {
+                sketch.lo = sketch.capacity;
+                sketch.hi = -1;
+            } else {
+                while (!sketch.counts[sketch.hi]) --sketch.hi;
+            }
+        }
+    }
+    return 1;
+}
+
+
+inline void incrementBinCount(int key, BinCount count, DenseSketch& sketch) {
+
+    if (key == -MIN_KEY) {
+        if (!sketch.zeroCount) {
+            ++sketch.bins;
+        }
+        sketch.zeroCount += count;
+        sketch.below += (sketch.cursor != -1) ? count : 0;
+        return;
+    }
+
+    int idx = key - sketch.offset;
+    if ((unsigned)idx >= (unsigned)sketch.capacity) {
+        growDenseSketch(sketch, key);
+        idx = key - sketch.offset;
+    }
+
+    sketch.below += (idx < sketch.cursor) ? count : 0;
+    if (!sketch.counts[idx]) {
+        ++sketch.bins;
+        if (idx < sketch.lo) sketch.lo = idx;
+        if (idx > sketch.hi) sketch.hi = idx;
+    }
+    sketch.counts[idx] += count;
+}
+
+
+inline int decreaseBinCount(int key, BinCount count, DenseSketch& sketch) {
+
+    BinCount *bin;
+    int isBelow;
+    if (key == -MIN_KEY) {
+        bin = &sketch.zeroCount;
+        isBelow = (sketch.cursor != -1);
+    } else {
+        int idx = key - sketch.offset;
+        bin = ((unsigned)idx < (unsigned)sketch.capacity) ? &sketch.counts[idx] : NULL;
+        isBelow = (idx < sketch.cursor);
+    }
+
+    if (bin == NULL || *bin < count) {
+        return -1;
+    }
+
+    sketch.below -= isBelow ? count : 0;
+    *bin -= count;
+    if (!*bin) {
+        --sketch.bins;
+        if (bin != &sketch.zeroCount) {
+            while (sketch.lo <= sketch.hi && !sketch.counts[sketch.lo]) ++sketch.lo;
+            if (sketch.lo > sketch.hi) {
+                sketch.lo = sketch.capacity;
+                sketch.hi = -1;
+            } else {
+                while (!sketch.counts[sketch.hi]) --sketch.hi;
+            }
+        }
+    }
+    return 1;
+}
+
+
+inline int getSketchSize(DenseSketch& sketch) {
+    return sketch.bins;
+}
+
+
+// Keys the buckets of a sketch bounded to sketchBound may span: the memory follows the
+// span, not the non-empty buckets, so a wider one calls for a collapse
+inline int getDenseSpanBound(int sketchBound) {
+    long span = std::max((long)DENSE_SPAN_FACTOR*sketchBound, (long)DENSE_INITIAL_CAPACITY);
+    return (int)std::min(span, (long)DENSE_MAX_CAPACITY/2);
+}
+
+
+inline int fitSketchKeys(DenseSketch& sketch, int minKey, int maxKey, int maxSpan) {
+
+    if (minKey > maxKey) {
+        return 1;
+    }
+    if (sketch.lo <= sketch.hi) {
+        minKey = std::min(minKey, sketch.offset + sketch.lo);
+        maxKey = std::max(maxKey, sketch.offset + sketch.hi);
+    }
+    return (long)maxKey - minKey < maxSpan;
+}
+
+
+BinCount getSketchPopulation(DenseSketch& sketch);
+
+
+
+//****** ****** ****** ****** ****** ************ Queries and Collapse
+
+double estimator(DenseSketch& mySketch, double q, double gamma);
+
+int seekRankCursor(DenseSketch& sketch, double fraction);
+
+double estimateQ(DenseSketch& Sketch, double q, double gamma, long n);
+
+void debugSketch(DenseSketch& mySketch);
+
+int getSketchBuckets(DenseSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity);
+
+void collapseUniformly(DenseSketch& mySketch);
+
+
+#endif //__DENSESKETCH_H__
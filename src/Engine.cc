@@ -0,0 +1,219 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "Engine.h"
+
+
+template <class SelectionT>
+static Value slideWith(AfqnEngine *engine, Value item) {
+    return slideEngine<SelectionT>(engine, item);
+}
+
+
+int initEngine(AfqnEngine *engine, int s, int sketchBound, double alpha, int diffFraction, SelectionMode selection) {
+
+    if (s < 3 || alpha < MIN_ALPHA || alpha >= 1.0 || diffFraction < 1 || diffFraction > s-1) {
+        return 1;
+    }
+    #if defined(LARGE_WINDOW) || defined(RUNLENGTH)
+        if (diffFraction > 1) {
+            return 1;
+        }
+    #endif
+
+    engine->s = s;
+    engine->sketchBound = sketchBound;
+    engine->ndiffs = (s-1 + diffFraction-1)/diffFraction;
+
+    engine->slide = slideWith<FullSelection>;
+    engine->team = NULL;
+    engine->publisher = NULL;
+    #if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+        if (diffFraction > 1) {
+            engine->slide = (selection == UNIFORM_SELECTION) ? slideWith<UniformSelection> : slideWith<NearestSelection>;
+        }
+    #endif
+
+    engine->window = (Value *)allocateAligned(windowCapacity(s)*sizeof(Value));
+    engine->seqNo = (long *)allocateAligned(s*sizeof(long));
+    engine->pos = -1;
+    engine->count = 0;
+    #if defined(LARGE_WINDOW)
+        initSortedWindow(&engine->Pwindow, s);
+    #elif defined(RUNLENGTH)
+        initRunWindow(&engine->Pwindow, s);
+    #else
+        engine->Pwindow = (Value *)allocateAligned(s*sizeof(Value));
+    #endif
+
+    engine->currentAlpha = alpha;
+    engine->currentGamma = getCurrentGamma(alpha);
+    engine->currentLogG = getCurrentLogG(engine->currentGamma);
+    #if defined(PYRAMID)
+        initSketchPyramid(&engine->Sketch, alpha, DENSE_INITIAL_CAPACITY);
+    #elif defined(MAPSKETCH)
+        initNodePool(&engine->SketchPool, NODE_POOL_CHUNK);
+        engine->Sketch.~MapSketch();
+        new (&engine->Sketch) MapSketch((std::less<int>()), MapSketch::allocator_type(&engine->SketchPool));
+    #elif defined(LOGLINEAR)
+        initLogLinearSketch(&engine->Sketch, alpha, DENSE_INITIAL_CAPACITY);
+    #elif defined(FENWICK)
+        initFenwickSketch(&engine->Sketch, DENSE_INITIAL_CAPACITY);
+    #else
+        initDenseSketch(&engine->Sketch, DENSE_INITIAL_CAPACITY);
+    #endif
+    engine->population = 0;
+    engine->sketchSize = 0;
+    engine->collapses = 0;
+
+    engine->keySpan = getDenseSpanBound(sketchBound);
+    engine->fitLo = 0.0;
+    engine->fitHi = 0.0;
+    engine->fitCollapses = -1;
+
+    int h = s/2 + 1;
+    engine->kth = (long)h*(h-1)/2;
+    engine->I = (long)s*(s-1)/2;
+    engine->quantile = getQuantileFraction(engine->kth, engine->I);
+    engine->QnScale = getQnScaleFactor(s, QFactor);
+
+    engine->median = 0.0;
+    engine->Qn = 0.0;
+    return 0;
+}
+
+
+int setEngineThreads(AfqnEngine *engine, int threads) {
+
+    #if defined(LARGE_WINDOW) || defined(RUNLENGTH)
+        return threads != 1;
+    #else
+        if (threads < 1 || (threads > 1 && engine->ndiffs != engine->s-1)) {
+            return 1;
+        }
+
+        if (engine->team != NULL) {
+            destroyWindowTeam(engine->team);
+            delete engine->team;
+            engine->team = NULL;
+            engine->slide = slideWith<FullSelection>;
+        }
+        if (threads > 1) {
+            engine->team = new WindowTeam;
+            initWindowTeam(engine->team, threads, engine->s);
+            engine->slide = slideWith<TeamUpdate>;
+        }
+        return 0;
+    #endif
+}
+
+
+int setEnginePublisher(AfqnEngine *engine, int every) {
+
+    if (every < 0) {
+        return 1;
+    }
+
+    if (engine->publisher != NULL) {
+        destroyPublisher(engine->publisher);
+        delete engine->publisher;
+        engine->publisher = NULL;
+    }
+    if (every > 0) {
+        engine->publisher = new Publisher;
+        initPublisher(engine->publisher, every, engine->sketchBound);
+    }
+    return 0;
+}
+
+
+void destroyEngine(AfqnEngine *engine) {
+
+    if (engine->team != NULL) {
+        destroyWindowTeam(engine->team);
+        delete engine->team;
+    }
+    if (engine->publisher != NULL) {
+        destroyPublisher(engine->publisher);
+        delete engine->publisher;
+    }
+
+    #if defined(PYRAMID)
+        destroySketchPyramid(&engine->Sketch);
+    #elif defined(MAPSKETCH)
+        engine->Sketch.clear();
+        destroyNodePool(&engine->SketchPool);
+    #elif defined(LOGLINEAR)
+        destroyLogLinearSketch(&engine->Sketch);
+    #elif defined(FENWICK)
+        destroyFenwickSketch(&engine->Sketch);
+    #else
+        destroyDenseSketch(&engine->Sketch);
+    #endif
+
+    free(engine->window);
+    free(engine->seqNo);
+    #if defined(LARGE_WINDOW)
+        destroySortedWindow(&engine->Pwindow);
+    #elif defined(RUNLENGTH)
+        destroyRunWindow(&engine->Pwindow);
+    #else
+        free(engine->Pwindow);
+    #endif
+}
+
+
+void warmupEngine(AfqnEngine *engine, const Value *items) {
+
+    for (int i = 0; i < engine->s; ++i) {
+        fillEngine(engine, items[i]);
+    }//for
+}
+
+
+int pushEngine(AfqnEngine *engine, Value item, Item *result) {
+
+    if (engine->count < engine->s) {
+        fillEngine(engine, item);
+        return 0;
+    }//fi warm-up
+
+    engine->slide(engine, item);
+    estimateEngine(engine);
+    getEngineResult(engine, result);
+    publishEngineResult(engine, result);
+    return 1;
+}
+
+
+long pushEngineBatch(AfqnEngine *engine, const Value *items, long n, Item *results) {
+
+    long i = 0;
+    for (; i < n && engine->count < engine->s; ++i) {
+        fillEngine(engine, items[i]);
+    }//for warm-up
+
+    long written = 0;
+    for (; i < n; ++i) {
+        engine->slide(engine, items[i]);
+        estimateEngine(engine);
+        getEngineResult(engine, &results[written]);
+        publishEngineResult(engine, &results[written]);
+        ++written;
+    }//for
+    return written;
+}
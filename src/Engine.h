@@ -0,0 +1,396 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include "DDSketch.h"
+#include "DenseSketch.h"
+#include "FenwickSketch.h"
+#include "FixedWindow.h"
+#include "IIS.h"
+#include "SketchPyramid.h"
+#include "LogLinearSketch.h"
+#include "Publisher.h"
+#include "Utility.h"
+#include "WindowTeam.h"
+
+#if defined(RUNLENGTH) && (defined(LARGE_WINDOW) || defined(RANGE))
+    #error "RUNLENGTH, LARGE_WINDOW and RANGE are alternative sorted windows"
+#endif
+
+#if (defined(LOGLINEAR) + defined(PYRAMID) + defined(MAPSKETCH) + defined(FENWICK)) > 1
+    #error "LOGLINEAR, PYRAMID, MAPSKETCH and FENWICK are alternative sketch backends"
+#endif
+
+
+// Sketch backend and sorted window chosen at build time
+#if defined(PYRAMID)
+    typedef SketchPyramid EngineSketch;
+#elif defined(MAPSKETCH)
+    typedef MapSketch EngineSketch;
+#elif defined(LOGLINEAR)
+    typedef LogLinearSketch EngineSketch;
+#elif defined(FENWICK)
+    typedef FenwickSketch EngineSketch;
+#else
+    typedef DenseSketch EngineSketch;
+#endif
+
+#if defined(LARGE_WINDOW)
+    typedef SortedWindow OrderedWindow;
+#elif defined(RUNLENGTH)
+    typedef RunWindow<Value> OrderedWindow;
+#else
+    typedef Value *OrderedWindow;
+#endif
+
+
+struct AfqnEngine;
+
+typedef Value (*EngineSlide)(struct AfqnEngine *engine, Value item);
+
+
+// Online median and Qn estimator over a sliding window of s items: the window, its sorted
+// copy, the sketch of the pairwise differences and the collapse state, with no global
+// state and no I/O, so that any number of engines can run in one process.
+// An engine must not be copied: a map sketch points to the node pool next to it.
+typedef struct AfqnEngine {
+    int s;
+    int sketchBound;
+    int ndiffs;                 // differences refreshed per item, s-1 for a full update
+    EngineSlide slide;          // full or partial update, chosen by initEngine()
+    WindowTeam *team;           // threads the full update is split over, NULL for none
+    Publisher *publisher;       // latest results for reader threads, NULL for none
+
+    Value *window;              // the last s items, window[pos] the newest
+    long *seqNo;
+    int pos;
+    long count;                 // items pushed so far
+    OrderedWindow Pwindow;
+
+    EngineSketch Sketch;
+    #if defined(MAPSKETCH)
+        NodePool SketchPool;
+    #endif
+    double currentAlpha;
+    double currentGamma;
+    double currentLogG;
+    long population;            // differences in the sketch
+    int sketchSize;
+    int collapses;
+
+    int keySpan;                // keys the buckets may span before a collapse, however few they are
+    double fitLo;               // differences known to fit keySpan since collapse fitCollapses
+    double fitHi;
+    int fitCollapses;
+
+    long I;                     // s(s-1)/2 differences in a full window
+    long kth;
+    double quantile;
+    double QnScale;
+
+    double median;              // of the window, once full
+    double Qn;                  // estimate of the kth difference, not yet scaled by QnScale
+} AfqnEngine;
+
+
+
+// Returns 0, or 1 if s < 3, alpha is outside [MIN_ALPHA, 1) or diffFraction outside [1, s-1];
+// diffFraction and selection are those of -t and -u
+int initEngine(AfqnEngine *engine, int s, int sketchBound, double alpha, int diffFraction, SelectionMode selection);
+
+void destroyEngine(AfqnEngine *engine);
+
+// Splits the full update of every item over threads (the caller and threads-1 spinning
+// ones), 1 for none. Returns 0, or 1 if threads > 1 with a partial update or in a build
+// without the plain sorted window (LARGE_WINDOW, RUNLENGTH).
+int setEngineThreads(AfqnEngine *engine, int threads);
+
+// Publishes the result of one item in every `every` pushed through pushEngine() or
+// pushEngineBatch() for reader threads (see Publisher.h), with a copy of the sketch when
+// one of them asks; 0 stops. Readers use engine->publisher, so it must be set before they
+// start. Returns 0, or 1 if every < 0.
+int setEnginePublisher(AfqnEngine *engine, int every);
+
+// Fills an empty engine with its first s items
+void warmupEngine(AfqnEngine *engine, const Value *items);
+
+// Returns 1 and the result for the middle item of the window, or 0 while the window fills
+int pushEngine(AfqnEngine *engine, Value item, Item *result);
+
+// Pushes n items; returns the number of results written, n less those taken by the warm-up
+long pushEngineBatch(AfqnEngine *engine, const Value *items, long n, Item *results);
+
+
+
+//****** ****** ****** ****** ****** ************ Per-item steps, inline for the main loop
+
+// Full update: all the differences of the two items, through the window engines
+template <class SketchT>
+inline int updateWindowSketch(FullSelection, Value oldest_item, Value item, Value *window, int pos, OrderedWindow& Pwindow, int s, int ndiffs, SketchT& Sketch, double gamma, double logG) {
+
+    #if defined(LARGE_WINDOW)
+        updateSynopsisRanges(oldest_item, item, Pwindow, Sketch, gamma, logG);
+    #elif defined(RUNLENGTH)
+        updateSynopsisRuns(oldest_item, item, Pwindow, Sketch, gamma, logG);
+    #elif defined(RANGE)
+        updateSynopsisRanges(oldest_item, item, Pwindow, s, Sketch, gamma, logG);
+    #else
+        updateSynopsisWindow(oldest_item, item, window, pos, Pwindow, s, Sketch, gamma, logG);
+    #endif
+    return 0;
+}
+
+#if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+// Partial update: ndiffs differences chosen by SelectionT; the population may change
+template <class SelectionT, class SketchT>
+inline int updateWindowSketch(SelectionT, Value oldest_item, Value item, Value *window, int pos, Value *Pwindow, int s, int ndiffs, SketchT& Sketch, double gamma, double logG) {
+    return updateSketch<SelectionT>(oldest_item, item, Pwindow, s, Sketch, gamma, logG, ndiffs);
+}
+#endif
+
+
+template <class SelectionT>
+inline int updateEngineSketch(SelectionT selection, AfqnEngine *engine, Value oldest_item, Value item, double gamma, double logG) {
+    return updateWindowSketch(selection, oldest_item, item, engine->window, engine->pos, engine->Pwindow, engine->s, engine->ndiffs, engine->Sketch, gamma, logG);
+}
+
+#if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+// Full update by the team of the engine
+inline int updateEngineSketch(TeamUpdate, AfqnEngine *engine, Value oldest_item, Value item, double gamma, double logG) {
+    updateSynopsisTeam(*engine->team, oldest_item, item, engine->window, engine->pos, engine->s, engine->Sketch, gamma, logG);
+    updateSortedWindow(engine->Pwindow, engine->s, item, oldest_item);
+    return 0;
+}
+#endif
+
+
+// Smallest non-null and largest difference of item with the previous items while the window
+// fills, with the sorted window (the oldest item still in it) once full; lo > hi if none
+inline void getEngineDiffRange(AfqnEngine *engine, Value item, double *lo, double *hi) {
+
+    *lo = INFINITY;
+    *hi = 0.0;
+
+    if (engine->count <= engine->s) {
+        for (int j = 0; j < engine->pos; ++j) {
+            double d = absDiff(engine->window[j], item);
+            if (d > 0.0) {
+                *lo = std::min(*lo, d);
+                *hi = std::max(*hi, d);
+            }
+        }//for
+        return;
+    }//fi filling
+
+    #if defined(LARGE_WINDOW)
+        SortedWindow& w = engine->Pwindow;
+        int below = rankOfSorted(w, item);
+        int above = rankOfSorted(w, nextafter((double)item, INFINITY));
+        if (below > 0) {
+            *lo = absDiff((Value)sortedAt(w, below-1), item);
+            *hi = absDiff((Value)sortedAt(w, 0), item);
+        }
+        if (above < w.size) {
+            *lo = std::min(*lo, absDiff((Value)sortedAt(w, above), item));
+            *hi = std::max(*hi, absDiff((Value)sortedAt(w, w.size-1), item));
+        }
+    #else
+        #if defined(RUNLENGTH)
+            Value *first = engine->Pwindow.values;
+            Value *last = first + engine->Pwindow.runs;
+        #else
+            Value *first = engine->Pwindow;
+            Value *last = first + engine->s;
+        #endif
+        Value *below = std::lower_bound(first, last, item);
+        Value *above = std::upper_bound(below, last, item);
+        if (below > first) {
+            *lo = absDiff(below[-1], item);
+            *hi = absDiff(first[0], item);
+        }
+        if (above < last) {
+            *lo = std::min(*lo, absDiff(above[0], item));
+            *hi = std::max(*hi, absDiff(last[-1], item));
+        }
+    #endif
+}
+
+
+// Key of a difference of two items, as absDiff() gives it
+template <class SketchT>
+inline int getEngineDiffKey(SketchT& sketch, double d, double gamma, double logG) {
+    #if defined(INT32)
+        return getIntSketchKey(sketch, (uint32_t)d, gamma, logG);
+    #else
+        return getSketchKey(sketch, d, gamma, logG);
+    #endif
+}
+
+
+// Collapses until the keys of the differences of item fit the span the sketch may take,
+// so that a few buckets far apart cannot grow a dense sketch without bound. The range
+// of differences checked since the last collapse is kept, and items within it skip the keys.
+inline void fitEngineKeys(AfqnEngine *engine, Value item) {
+
+    double lo, hi;
+    getEngineDiffRange(engine, item, &lo, &hi);
+    if (lo > hi) {
+        return;
+    }
+    if (engine->fitCollapses == engine->collapses) {
+        if (lo >= engine->fitLo && hi <= engine->fitHi) {
+            return;
+        }
+        lo = std::min(lo, engine->fitLo);
+        hi = std::max(hi, engine->fitHi);
+    }
+
+    for (;;) {
+        double gamma = getKeyGamma(engine->Sketch, engine->currentGamma);
+        double logG = getKeyLogG(engine->Sketch, engine->currentLogG);
+        int minKey = getEngineDiffKey(engine->Sketch, lo, gamma, logG);
+        int maxKey = getEngineDiffKey(engine->Sketch, hi, gamma, logG);
+        if (fitSketchKeys(engine->Sketch, minKey, maxKey, engine->keySpan)) {
+            break;
+        }
+
+        engine->currentAlpha = getCurrentAlpha(engine->currentAlpha);
+        engine->currentGamma = getCurrentGamma(engine->currentAlpha);
+        engine->currentLogG = getCurrentLogG(engine->currentGamma);
+        collapseUniformly(engine->Sketch);
+        ++engine->collapses;
+    }//for fit
+
+    engine->fitLo = lo;
+    engine->fitHi = hi;
+    engine->fitCollapses = engine->collapses;
+}
+
+
+// One of the first s items: its differences with the previous ones go into the sketch
+inline void fillEngine(AfqnEngine *engine, Value item) {
+
+    ++(engine->count);
+    ++(engine->pos);
+    engine->window[engine->pos] = item;
+    engine->seqNo[engine->pos] = engine->count;
+
+    if (engine->pos == 0) {
+        #if defined(LARGE_WINDOW)
+            insertSorted(engine->Pwindow, item);
+        #elif defined(RUNLENGTH)
+            insertRun(engine->Pwindow, item);
+        #endif
+        return;
+    }//fi first item
+
+    fitEngineKeys(engine, item);
+    double gamma = getKeyGamma(engine->Sketch, engine->currentGamma);
+    double logG = getKeyLogG(engine->Sketch, engine->currentLogG);
+    #if defined(LARGE_WINDOW)
+        engine->population += fillSketchRanges(item, engine->Pwindow, engine->Sketch, gamma, logG);
+    #elif defined(RUNLENGTH)
+        engine->population += fillSketchRuns(item, engine->Pwindow, engine->Sketch, gamma, logG);
+    #else
+        engine->population += fillSketch(engine->pos, engine->window, gamma, logG, engine->Sketch);
+    #endif
+    engine->collapses += performCollapse(engine->Sketch, engine->sketchBound, &engine->currentAlpha, &engine->currentGamma, &engine->currentLogG, &engine->sketchSize);
+
+    if (engine->pos == engine->s-1) {
+        #if !defined(LARGE_WINDOW) && !defined(RUNLENGTH)
+            sortWindow(engine->window, engine->Pwindow, engine->s);
+        #endif
+    }//fi window full
+}
+
+
+// Slides the full window by one item and updates the sketch; returns the item that left
+template <class SelectionT>
+inline Value slideEngine(AfqnEngine *engine, Value item) {
+
+    ++(engine->count);
+    engine->pos = (engine->pos+1)%engine->s;
+    Value oldest_item = engine->window[engine->pos];
+    engine->window[engine->pos] = item;
+    engine->seqNo[engine->pos] = engine->count;
+
+    if (oldest_item != item) {
+        fitEngineKeys(engine, item);
+        double gamma = getKeyGamma(engine->Sketch, engine->currentGamma);
+        double logG = getKeyLogG(engine->Sketch, engine->currentLogG);
+        engine->population += updateEngineSketch(SelectionT(), engine, oldest_item, item, gamma, logG);
+        engine->collapses += performCollapse(engine->Sketch, engine->sketchBound, &engine->currentAlpha, &engine->currentGamma, &engine->currentLogG, &engine->sketchSize);
+    }//fi
+    return oldest_item;
+}
+
+
+// Median of the full window
+inline void medianEngine(AfqnEngine *engine) {
+    #if defined(LARGE_WINDOW)
+        engine->median = sortedAt(engine->Pwindow, engine->s/2);
+    #elif defined(RUNLENGTH)
+        engine->median = runValueAt(engine->Pwindow, engine->s/2);
+    #else
+        engine->median = engine->Pwindow[engine->s/2];
+    #endif
+}
+
+
+// Median and Qn estimate of the full window
+inline void estimateEngine(AfqnEngine *engine) {
+    medianEngine(engine);
+    engine->Qn = estimateQ(engine->Sketch, engine->quantile, engine->currentGamma, engine->population);
+}
+
+
+// Slot of the item in the middle of the window by arrival, the one the estimates are checked on
+inline int middleEngine(const AfqnEngine *engine) {
+    return (engine->pos + 1 + engine->s/2)%engine->s;
+}
+
+
+// Result for the middle item: it is an outlier if farther than 3 Qn from the median
+inline void getEngineResult(AfqnEngine *engine, Item *result) {
+
+    int middle = middleEngine(engine);
+    result->seq = engine->seqNo[middle];
+    result->middle = engine->window[middle];
+    result->median = engine->median;
+    result->Qn = engine->QnScale * engine->Qn;
+    result->isOutlier = (fabs(result->middle - result->median) - (3 * result->Qn)) > 0;
+    result->collapses = engine->collapses;
+    result->alpha = engine->currentAlpha;
+    result->bins = getSketchSize(engine->Sketch);
+}
+
+
+inline void publishEngineResult(AfqnEngine *engine, const Item *result) {
+
+    Publisher *pub = engine->publisher;
+    if (pub != NULL && isPublicationDue(pub)) {
+        publishResult(pub, result);
+        if (isSketchRequested(pub)) {
+            publishSketch(pub, engine->Sketch, result->seq, engine->collapses, engine->currentAlpha, engine->currentGamma, engine->population);
+        }
+    }
+}
+
+
+#endif //__ENGINE_H__
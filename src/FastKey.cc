@@ -0,0 +1,37 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "FastKey.h"
+#include <cmath>
+
+
+static FastLog2Table buildFastLog2Table() {
+
+    FastLog2Table table;
+    for (int i = 0; i < LOG2_TABLE_SIZE; ++i) {
+        double c = 1.0 + (i + 0.5)/LOG2_TABLE_SIZE;
+        table.centre[i] = c;
+        table.invCentre[i] = 1.0/c;
+        table.log2Centre[i] = std::log2(c);
+        table.invCentreF[i] = (float)table.invCentre[i];
+        table.log2CentreF[i] = (float)table.log2Centre[i];
+    }//for
+    return table;
+}
+
+
+const FastLog2Table FAST_LOG2 = buildFastLog2Table();
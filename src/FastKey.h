@@ -0,0 +1,112 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __FASTKEY_H__
+#define __FASTKEY_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+
+
+const int LOG2_TABLE_BITS = 8;
+const int LOG2_TABLE_SIZE = 1 << LOG2_TABLE_BITS;
+
+const double LOG10_2 = 0.30102999566398119521;
+const double INV_LN2 = 1.44269504088896340736;
+
+// Relative width of the band around a bucket boundary where the fast key is not
+// trusted: the log2 below and the reference log10 are both within a few ulps of
+// the exact value, so 1e-12 leaves three orders of magnitude of margin.
+const double KEY_SLACK = 1e-12;
+
+// Same band for the single precision log2 of the float kernels: its error is a few
+// float ulps (6e-8 each) of |log2| + 1, so 4e-6 leaves more than an order of magnitude
+const float KEY_SLACK_F = 4e-6f;
+
+
+// log2 of the mantissa split as log2(c_i) + log2(1+r), with c_i the centre of the
+// i-th of 256 sub-intervals of [1,2) and |r| <= 2^-9
+typedef struct FastLog2Table {
+    double centre[LOG2_TABLE_SIZE];
+    double invCentre[LOG2_TABLE_SIZE];
+    double log2Centre[LOG2_TABLE_SIZE];
+
+    float invCentreF[LOG2_TABLE_SIZE];      // single precision copies for the float kernels
+    float log2CentreF[LOG2_TABLE_SIZE];
+} FastLog2Table;
+
+extern const FastLog2Table FAST_LOG2;
+
+
+
+// std::ceil is a library call unless SSE4.1 is enabled; |x| must fit an int
+inline int ceilToInt(double x) {
+    int t = (int)x;
+    return t + (t < x);
+}
+
+
+// Returns false for zero, subnormal, infinite and NaN values
+inline bool fastLog2(double value, double *result) {
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    int e = (int)((bits >> 52) & 0x7ff);
+    if (e == 0 || e == 0x7ff) {
+        return false;
+    }
+
+    int i = (int)((bits >> (52 - LOG2_TABLE_BITS)) & (LOG2_TABLE_SIZE-1));
+    uint64_t mbits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    double m;
+    memcpy(&m, &mbits, sizeof(m));
+
+    double r = (m - FAST_LOG2.centre[i]) * FAST_LOG2.invCentre[i];     // m - centre is exact
+    double ln = r*(1.0 - r*(0.5 - r*(1.0/3.0 - r*(0.25 - r*0.2))));
+
+    *result = (double)(e - 1023) + FAST_LOG2.log2Centre[i] + ln*INV_LN2;
+    return true;
+}
+
+
+// Key ceil(log2(value)*scale), scale = log10(2)/logG, when it is certain to match
+// the log10 computation; false if the reference one must be used instead
+inline bool fastKey(double value, double scale, int *key) {
+
+    double l2;
+    if (!fastLog2(value, &l2)) {
+        return false;
+    }
+
+    double x = l2*scale;
+    double slack = KEY_SLACK*(std::abs(x) + 4.0*scale);
+    if (!(std::abs(x) < (1 << 30))) {
+        return false;
+    }
+
+    int k = ceilToInt(x - slack);
+    if (k != ceilToInt(x + slack)) {
+        return false;
+    }
+    *key = k;
+    return true;
+}
+
+
+#endif //__FASTKEY_H__
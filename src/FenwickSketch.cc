@@ -0,0 +1,191 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "FenwickSketch.h"
+#include <stdlib.h>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Memory management
+
+void initFenwickSketch(FenwickSketch *sketch, int capacity) {
+
+    initDenseSketch(&sketch->dense, capacity);
+
+    sketch->tree = NULL;
+    sketch->treeCapacity = 0;
+    sketch->population = 0;
+
+    rebuildRankIndex(*sketch);
+}
+
+
+void destroyFenwickSketch(FenwickSketch *sketch) {
+
+    if (sketch) {
+        destroyDenseSketch(&sketch->dense);
+        if (sketch->tree) {
+            free(sketch->tree);
+            sketch->tree = NULL;
+        }
+    }//fi
+}
+
+
+void rebuildRankIndex(FenwickSketch& sketch) {
+
+    int n = sketch.dense.capacity;
+
+    if (n != sketch.treeCapacity) {
+        free(sketch.tree);
+        sketch.tree = (BinCount *)malloc((n+1)*sizeof(BinCount));
+        if (sketch.tree == NULL) {
+            std::cerr << "ERROR: unable to allocate the rank index" << std::endl;
+            exit(1);
+        }
+        sketch.treeCapacity = n;
+    }
+    sketch.treeOffset = sketch.dense.offset;
+
+    sketch.tree[0] = 0;
+    for (int i = 1; i <= n; ++i) {
+        sketch.tree[i] = sketch.dense.counts[i-1];
+    }//for
+
+    for (int i = 1; i <= n; ++i) {
+        int parent = i + (i & (-i));
+        if (parent <= n) {
+            sketch.tree[parent] += sketch.tree[i];
+        }
+    }//for
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Rank queries
+
+// Key of the first bucket whose cumulative count exceeds rank (the bucket estimator() stops on)
+int keyAtRank(FenwickSketch& sketch, double rank) {
+
+    DenseSketch& dense = sketch.dense;
+    if (dense.zeroCount > rank || dense.lo > dense.hi) {
+        return -MIN_KEY;
+    }
+
+    BinCount remaining = (BinCount)std::floor(rank) - dense.zeroCount;
+
+    int step = 1;
+    while (2*step <= sketch.treeCapacity) {
+        step *= 2;
+    }//wend
+
+    // descend to the longest prefix whose count does not exceed rank
+    int pos = 0;
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= sketch.treeCapacity && sketch.tree[pos + step] <= remaining) {
+            pos += step;
+            remaining -= sketch.tree[pos];
+        }
+    }//for
+
+    if (pos > dense.hi) {
+        pos = dense.hi;     // rank beyond the population: last bucket
+    }
+    return dense.offset + pos;
+}
+
+
+// Number of differences stored in buckets with key not greater than key
+BinCount rankOfKey(FenwickSketch& sketch, int key) {
+
+    if (key == -MIN_KEY) {
+        return sketch.dense.zeroCount;
+    }
+
+    int idx = key - sketch.treeOffset;
+    if (idx < 0) {
+        return sketch.dense.zeroCount;
+    }
+    if (idx >= sketch.treeCapacity) {
+        return sketch.population;
+    }
+
+    BinCount count = sketch.dense.zeroCount;
+    for (int i = idx+1; i > 0; i -= i & (-i)) {
+        count += sketch.tree[i];
+    }//for
+    return count;
+}
+
+
+double valueAtRank(FenwickSketch& sketch, double rank, double gamma) {
+
+    int i = keyAtRank(sketch, rank);
+    return (2.0 * pow(gamma,i))/(gamma+1.0);
+}
+
+
+BinCount rankOfValue(FenwickSketch& sketch, double value, double gamma, double logG) {
+
+    return rankOfKey(sketch, getKeyFor(value, gamma, logG));
+}
+
+
+// q-quantile of the pairwise differences currently summarized, q in [0,1]
+double estimatePairwiseQuantile(FenwickSketch& sketch, double q, double gamma) {
+
+    if (q < 0.0 || q > 1.0) {
+        std::cerr << "ERROR: quantile " << q << " out of range [0,1]\n";
+        exit(1);
+    }
+    return valueAtRank(sketch, q*(sketch.population-1), gamma);
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Queries and Collapse
+
+double estimator(FenwickSketch& mySketch, double q, double gamma) {
+    return valueAtRank(mySketch, q, gamma);
+}
+
+
+// The tree counts the sketch population itself, which is the n of the caller
+double estimateQ(FenwickSketch& Sketch, double q, double gamma, long n) {
+
+    double estimate = estimatePairwiseQuantile(Sketch, q, gamma);
+
+    #ifdef DEBUG
+        std::cout << "Quantile: " << estimate << ", population " << n << ", fraction " << q*(Sketch.population-1) << std::endl;
+    #endif
+
+    return estimate;
+}
+
+
+void debugSketch(FenwickSketch& mySketch) {
+    debugSketch(mySketch.dense);
+}
+
+
+int getSketchBuckets(FenwickSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity) {
+    return getSketchBuckets(mySketch.dense, gamma, values, counts, capacity);
+}
+
+
+void collapseUniformly(FenwickSketch& mySketch) {
+
+    collapseUniformly(mySketch.dense);
+    rebuildRankIndex(mySketch);
+}
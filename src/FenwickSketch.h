@@ -0,0 +1,158 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __FENWICKSKETCH_H__
+#define __FENWICKSKETCH_H__
+
+#include "DenseSketch.h"
+
+
+// Dense sketch with a Fenwick (binary indexed) tree of prefix counts over its buckets:
+// rank and quantile queries cost O(log B) instead of a scan from the first bucket.
+typedef struct FenwickSketch {
+    DenseSketch dense;
+
+    BinCount *tree;     // 1-based, tree[i] covers dense.counts[i-(i&-i) .. i-1]
+    int treeOffset;     // layout of dense.counts the tree was built for
+    int treeCapacity;
+
+    BinCount population;
+} FenwickSketch;
+
+
+
+void initFenwickSketch(FenwickSketch *sketch, int capacity);
+
+void destroyFenwickSketch(FenwickSketch *sketch);
+
+void rebuildRankIndex(FenwickSketch& sketch);
+
+
+
+//****** ****** ****** ****** ****** ************ Bin access
+
+inline void fenwickAdd(FenwickSketch& sketch, int idx, BinCount delta) {
+    for (int i = idx+1; i <= sketch.treeCapacity; i += i & (-i)) {
+        sketch.tree[i] += delta;
+    }
+}
+
+
+inline void incrementBinCount(int key, FenwickSketch& sketch) {
+
+    incrementBinCount(key, sketch.dense);
+    ++sketch.population;
+
+    if (key == -MIN_KEY) {
+        return;
+    }
+
+    if (sketch.dense.offset != sketch.treeOffset || sketch.dense.capacity != sketch.treeCapacity) {
+        rebuildRankIndex(sketch);   // the dense array moved: the new count is already in it
+    } else {
+        fenwickAdd(sketch, key - sketch.treeOffset, 1);
+    }
+}
+
+
+inline int decreaseBinCount(int key, FenwickSketch& sketch) {
+
+    int res = decreaseBinCount(key, sketch.dense);
+    if (res == 1) {
+        --sketch.population;
+        if (key != -MIN_KEY) {
+            fenwickAdd(sketch, key - sketch.treeOffset, -1);
+        }
+    }
+    return res;
+}
+
+
+inline void incrementBinCount(int key, BinCount count, FenwickSketch& sketch) {
+
+    incrementBinCount(key, count, sketch.dense);
+    sketch.population += count;
+
+    if (key == -MIN_KEY) {
+        return;
+    }
+
+    if (sketch.dense.offset != sketch.treeOffset || sketch.dense.capacity != sketch.treeCapacity) {
+        rebuildRankIndex(sketch);
+    } else {
+        fenwickAdd(sketch, key - sketch.treeOffset, count);
+    }
+}
+
+
+inline int decreaseBinCount(int key, BinCount count, FenwickSketch& sketch) {
+
+    int res = decreaseBinCount(key, count, sketch.dense);
+    if (res == 1) {
+        sketch.population -= count;
+        if (key != -MIN_KEY) {
+            fenwickAdd(sketch, key - sketch.treeOffset, -count);
+        }
+    }
+    return res;
+}
+
+
+inline int getSketchSize(FenwickSketch& sketch) {
+    return sketch.dense.bins;
+}
+
+
+inline BinCount getSketchPopulation(FenwickSketch& sketch) {
+    return sketch.population;
+}
+
+
+inline int fitSketchKeys(FenwickSketch& sketch, int minKey, int maxKey, int maxSpan) {
+    return fitSketchKeys(sketch.dense, minKey, maxKey, maxSpan);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ Rank queries
+
+int keyAtRank(FenwickSketch& sketch, double rank);
+
+BinCount rankOfKey(FenwickSketch& sketch, int key);
+
+double valueAtRank(FenwickSketch& sketch, double rank, double gamma);
+
+BinCount rankOfValue(FenwickSketch& sketch, double value, double gamma, double logG);
+
+double estimatePairwiseQuantile(FenwickSketch& sketch, double q, double gamma);
+
+
+
+//****** ****** ****** ****** ****** ************ Queries and Collapse
+
+double estimator(FenwickSketch& mySketch, double q, double gamma);
+
+double estimateQ(FenwickSketch& Sketch, double q, double gamma, long n);
+
+void debugSketch(FenwickSketch& mySketch);
+
+int getSketchBuckets(FenwickSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity);
+
+void collapseUniformly(FenwickSketch& mySketch);
+
+
+#endif //__FENWICKSKETCH_H__
@@ -0,0 +1,251 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "FixedWindow.h"
+#include "DDSketch.h"
+#include "DenseSketch.h"
+#include "FenwickSketch.h"
+#include "SketchPyramid.h"
+#include "LogLinearSketch.h"
+#include "WindowKernel.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Warm-up
+
+static constexpr int paddedSize(int s) {
+    return (s + FIXED_WINDOW_PAD - 1)/FIXED_WINDOW_PAD*FIXED_WINDOW_PAD;
+}
+
+
+template <class T>
+static inline void compareExchange(T *V, int i, int j) {
+    T a = V[i];
+    T b = V[j];
+    V[i] = std::min(a, b);
+    V[j] = std::max(a, b);
+}
+
+
+// Batcher's merge exchange (Knuth, TAOCP 5.2.2, Algorithm M): the comparators depend on S
+// only, so the whole network is known at compile time
+template <int S, class T>
+static void sortingNetwork(T *V) {
+
+    int t = 1;
+    while ((1 << t) < S) {
+        ++t;
+    }
+
+    for (int p = 1 << (t-1); p > 0; p >>= 1) {
+
+        int q = 1 << (t-1);
+        int r = 0;
+        int d = p;
+        while (true) {
+            for (int i = 0; i < S - d; ++i) {
+                if ((i & p) == r) {
+                    compareExchange(V, i, i + d);
+                }
+            }//for i
+            if (q == p) {
+                break;
+            }
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }//wend
+    }//for p
+}
+
+
+bool hasFixedWindow(int s) {
+
+    for (int size : FIXED_WINDOW_SIZES) {
+        if (size == s) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int windowCapacity(int s) {
+    return hasFixedWindow(s) ? paddedSize(s) : s;
+}
+
+
+template <class T>
+void sortWindow(const T *window, T *Pwindow, int s) {
+
+    if (hasFixedWindow(s)) {
+        memcpy(Pwindow, window, s*sizeof(T));
+    }
+
+    switch (s) {
+        case 11:
+            sortingNetwork<11>(Pwindow);
+            break;
+        case 31:
+            sortingNetwork<31>(Pwindow);
+            break;
+        case 101:
+            sortingNetwork<101>(Pwindow);
+            break;
+        default:
+            for (int j = 0; j < s; ++j) {
+                isort_v5(Pwindow, j, window[j]);
+            }
+    }//switch
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Update
+
+// Same result as updateSortedWindow(): both ranks are counted over the whole window,
+// which for a small S costs less than the two searches
+template <int S, class T>
+static inline void replaceSorted(T *Pwindow, T new_item, T old_item) {
+
+    int rOld = 0;
+    int rNew = 0;
+    for (int j = 0; j < S; ++j) {
+        rOld += (Pwindow[j] < old_item);
+        rNew += (Pwindow[j] < new_item);
+    }//for j
+
+    if (old_item < new_item) {
+        memmove(&Pwindow[rOld], &Pwindow[rOld+1], (rNew-1-rOld)*sizeof(T));
+        Pwindow[rNew-1] = new_item;
+    } else if (new_item < old_item) {
+        memmove(&Pwindow[rNew+1], &Pwindow[rNew], (rOld-rNew)*sizeof(T));
+        Pwindow[rNew] = new_item;
+    }//fi
+}
+
+
+// A power of two far enough from new_item and old_item that both differences round
+// to the value itself: its keys are equal and the kernel drops its pairs
+template <class T>
+static inline T padValue(T new_item, T old_item) {
+
+    int e = std::ilogb(std::max(std::abs(new_item), std::abs(old_item)));
+    return std::ldexp((T)1, e + std::numeric_limits<T>::digits + 2);
+}
+
+
+// Keys of the pairs of window[pos] = new_item that change bucket. The pad value fills
+// the window past S and, during the kernel, the slot of new_item: all the paddedSize(S)
+// differences are then computed by whole vectors in one call.
+template <int S, class SketchT, class T>
+static inline int fixedKeyDeltas(T old_item, T new_item, T *window, int pos, SketchT& Sketch, double gamma, double logGamma, int *keysA, int *keysR) {
+
+    T pad = padValue(new_item, old_item);
+    if (!std::isfinite(pad)) {
+        int n = getSketchKeyDeltas(Sketch, window, 0, pos, new_item, old_item, gamma, logGamma, keysA, keysR);
+        return n + getSketchKeyDeltas(Sketch, window, pos + 1, S, new_item, old_item, gamma, logGamma, &keysA[n], &keysR[n]);
+    }
+
+    for (int j = S; j < paddedSize(S); ++j) {
+        window[j] = pad;
+    }
+    window[pos] = pad;
+    int n = getSketchKeyDeltas(Sketch, window, 0, paddedSize(S), new_item, old_item, gamma, logGamma, keysA, keysR);
+    window[pos] = new_item;
+    return n;
+}
+
+
+// The integer kernel is a table lookup per pair: no vectors to fill
+template <int S, class SketchT>
+static inline int fixedKeyDeltas(int old_item, int new_item, int *window, int pos, SketchT& Sketch, double gamma, double logGamma, int *keysA, int *keysR) {
+
+    int n = getSketchKeyDeltas(Sketch, window, 0, pos, new_item, old_item, gamma, logGamma, keysA, keysR);
+    return n + getSketchKeyDeltas(Sketch, window, pos + 1, S, new_item, old_item, gamma, logGamma, &keysA[n], &keysR[n]);
+}
+
+
+template <int S, class SketchT, class T>
+static void updateFixedWindow(T old_item, T new_item, T *window, int pos, T *Pwindow, SketchT& Sketch, double gamma, double logGamma) {
+
+    std::array<int, paddedSize(S) + KERNEL_PAD> keysA;
+    std::array<int, paddedSize(S) + KERNEL_PAD> keysR;
+
+    int n = fixedKeyDeltas<S>(old_item, new_item, window, pos, Sketch, gamma, logGamma, keysA.data(), keysR.data());
+
+    for (int i = 0; i < n; ++i) {
+        incrementBinCount(keysA[i], Sketch);
+        if (decreaseBinCount(keysR[i], Sketch) != 1) {
+            std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
+            exit(1);
+        }
+    }//for i
+
+    replaceSorted<S>(Pwindow, new_item, old_item);
+}
+
+
+template <class SketchT, class T>
+void updateSynopsisWindow(T old_item, T new_item, T *window, int pos, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma) {
+
+    switch (s) {
+        case 11:
+            updateFixedWindow<11>(old_item, new_item, window, pos, Pwindow, Sketch, gamma, logGamma);
+            break;
+        case 31:
+            updateFixedWindow<31>(old_item, new_item, window, pos, Pwindow, Sketch, gamma, logGamma);
+            break;
+        case 101:
+            updateFixedWindow<101>(old_item, new_item, window, pos, Pwindow, Sketch, gamma, logGamma);
+            break;
+        default:
+            updateSynopsisRing(old_item, new_item, window, pos, s, Sketch, gamma, logGamma);
+            updateSortedWindow(Pwindow, s, new_item, old_item);
+    }//switch
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Instantiations
+
+template void sortWindow<double>(const double *, double *, int);
+template void sortWindow<float>(const float *, float *, int);
+template void sortWindow<int>(const int *, int *, int);
+
+#define INSTANTIATE_FIXED_WINDOW_OPS(SketchT, T) \
+    template void updateSynopsisWindow<SketchT, T>(T, T, T *, int, T *, int, SketchT&, double, double);
+
+INSTANTIATE_FIXED_WINDOW_OPS(MapSketch, double)
+INSTANTIATE_FIXED_WINDOW_OPS(DenseSketch, double)
+INSTANTIATE_FIXED_WINDOW_OPS(FenwickSketch, double)
+INSTANTIATE_FIXED_WINDOW_OPS(SketchPyramid, double)
+INSTANTIATE_FIXED_WINDOW_OPS(LogLinearSketch, double)
+INSTANTIATE_FIXED_WINDOW_OPS(MapSketch, float)
+INSTANTIATE_FIXED_WINDOW_OPS(DenseSketch, float)
+INSTANTIATE_FIXED_WINDOW_OPS(FenwickSketch, float)
+INSTANTIATE_FIXED_WINDOW_OPS(SketchPyramid, float)
+INSTANTIATE_FIXED_WINDOW_OPS(LogLinearSketch, float)
+INSTANTIATE_FIXED_WINDOW_OPS(MapSketch, int)
+INSTANTIATE_FIXED_WINDOW_OPS(DenseSketch, int)
+INSTANTIATE_FIXED_WINDOW_OPS(FenwickSketch, int)
+INSTANTIATE_FIXED_WINDOW_OPS(SketchPyramid, int)
+INSTANTIATE_FIXED_WINDOW_OPS(LogLinearSketch, int)
@@ -0,0 +1,48 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __FIXEDWINDOW_H__
+#define __FIXEDWINDOW_H__
+
+
+// Window sizes with an engine compiled for them: every loop over the window has a
+// compile-time trip count and the per-item work needs no chunking nor kernel dispatch.
+// Other sizes run on the generic functions (updateSynopsisRing, isort_v5, ...).
+const int FIXED_WINDOW_SIZES[] = {11, 31, 101};
+
+const int FIXED_WINDOW_PAD = 16;    // their key kernel runs on whole vectors: the window is padded to a multiple
+
+
+bool hasFixedWindow(int s);
+
+// Elements to allocate for the ring window of s items
+int windowCapacity(int s);
+
+
+// Sorts the s items of the full ring window into Pwindow (at the end of the warm-up):
+// a sorting network for the fixed sizes, insertion sort otherwise
+template <class T>
+void sortWindow(const T *window, T *Pwindow, int s);
+
+
+// window[pos] = new_item has replaced old_item: same sketch update as updateSynopsisRing()
+// followed by updateSortedWindow(), by the fixed engine for s when there is one
+template <class SketchT, class T>
+void updateSynopsisWindow(T old_item, T new_item, T *window, int pos, T *Pwindow, int s, SketchT& Sketch, double gamma, double logGamma);
+
+
+#endif //__FIXEDWINDOW_H__
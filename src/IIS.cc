@@ -15,19 +15,22 @@
 
 #include "IIS.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 //********************************************************************************** INSERTION SORT V5
 
 
 
-int isort_v5(double *V, int len, double new_item) {
+template <class T>
+int isort_v5(T *V, int len, T new_item) {
     
     if (len == 0) {
         V[0] = new_item;
         return 0; 
     }
 
-    double tmp = 0;
+    T tmp = 0;
     int k = 0;
     
     int pos = -1;               
@@ -126,7 +129,8 @@ return pos;
 
 
 
-int bsearch(double value, double *p, int size) {
+template <class T>
+int bsearch(T value, T *p, int size) {
     
     int l = 0;
     int r = size-1;
@@ -148,7 +152,10 @@ int bsearch(double value, double *p, int size) {
 
 
 
-void updateSortedWindow(double *Pi, int s, double new_item, double old_item) {
+// Replaces old_item with new_item in the sorted window: a binary search finds both
+// positions and a single memmove shifts the elements in between
+template <class T>
+void updateSortedWindow(T *Pi, int s, T new_item, T old_item) {
     
     int pos = -1;
 
@@ -156,45 +163,38 @@ void updateSortedWindow(double *Pi, int s, double new_item, double old_item) {
         return;
     }//fi old=new
 
+    pos = bsearch(old_item, Pi, s);
+    if (pos == -1){
+        std::cerr << "ERROR while searching an existing item in Pwindow " << std::endl;
+        exit(1);
+    }
 
     if (old_item < new_item) {   
-        pos = bsearch(old_item, Pi, s);
-        if (pos == -1){
-            std::cerr << "ERROR while searching an existing item in Pwindow " << std::endl;
-            exit(1);
-        }
-       
-        for ( int p = pos; p < s-1; ++p) {
-            if (Pi[p+1] < new_item){
-                Pi[p] = Pi[p+1];
-            } else {
-                Pi[p] = new_item;
-                return; 
-            }//fi check
-        }//for insert new_item
-
-        Pi[s-1] = new_item;
-        return;
+        // first position after pos holding an item >= new_item
+        int q = std::lower_bound(Pi + pos + 1, Pi + s, new_item) - Pi;
+
+        memmove(&Pi[pos], &Pi[pos+1], (q-1-pos)*sizeof(T));
+        Pi[q-1] = new_item;
     }// fi (old_item < new_item)
     else 
     { 
-        pos = bsearch(old_item, Pi, s);
-        if (pos == -1){
-            std::cerr << "ERROR while searching an existing item in Pi " << std::endl;
-            exit(1);
-        }
-
-        for (int p = pos; p > 0; --p) {
-            if (Pi[p-1] > new_item){
-                Pi[p] = Pi[p-1];
-            } else {
-                Pi[p] = new_item;
-                return; 
-            }//fi check
-        }//for
+        // first position holding an item > new_item, never past pos
+        int q = std::upper_bound(Pi, Pi + pos, new_item) - Pi;
 
-        Pi[0] = new_item;
-
-        return;
+        memmove(&Pi[q+1], &Pi[q], (pos-q)*sizeof(T));
+        Pi[q] = new_item;
     }// fi (new_item < old_item)  
 } 
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Instantiations
+
+#define INSTANTIATE_WINDOW_OPS(T) \
+    template int isort_v5<T>(T *, int, T); \
+    template int bsearch<T>(T, T *, int); \
+    template void updateSortedWindow<T>(T *, int, T, T);
+
+INSTANTIATE_WINDOW_OPS(double)
+INSTANTIATE_WINDOW_OPS(float)
+INSTANTIATE_WINDOW_OPS(int)
@@ -26,7 +26,10 @@ typedef struct Pos {
 
 
 
-int isort_v5(double *V, int len, double new_item);
+// Sorted-window functions are defined for T = double, float and int
+
+template <class T>
+int isort_v5(T *V, int len, T new_item);
 
 
 int updateValues_v5(double *V, int n, double new_item, double old_item, Pos *positions);
@@ -34,10 +37,12 @@ int updateValues_v5(double *V, int n, double new_item, double old_item, Pos *pos
 
 
 // ******************* Working on sorted permutation of W
-int bsearch(double value, double *p, int size);
+template <class T>
+int bsearch(T value, T *p, int size);
 
 
-void updateSortedWindow(double *Pi, int s, double new_item, double old_item);
+template <class T>
+void updateSortedWindow(T *Pi, int s, T new_item, T old_item);
 
 
 #endif //__IIS_H__
@@ -0,0 +1,100 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "IntKey.h"
+
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// Tables published so far: written once under the lock, then read without it
+static std::atomic<const IntKeyTable *> INT_KEY_TABLE_SET[INT_KEY_TABLES];
+static std::atomic<int> INT_KEY_TABLE_COUNT(0);
+static std::mutex INT_KEY_TABLE_LOCK;
+
+thread_local const IntKeyTable *LAST_INT_KEYS = NULL;
+
+// Past INT_KEY_TABLES resolutions a thread keys on a private table, rebuilt when its resolution changes
+static thread_local IntKeyTable *PRIVATE_INT_KEYS = NULL;
+
+
+void buildIntKeyTable(IntKeyTable *table, double gamma, double logG) {
+
+    for (int d = 0; d < INT_KEY_TABLE_SIZE; ++d) {
+        table->keys[d] = getKeyFor((double)d, gamma, logG);
+    }//for
+    table->logG = logG;
+}
+
+
+static const IntKeyTable *searchIntKeyTables(double logG, int from, int to) {
+
+    for (int t = from; t < to; ++t) {
+        const IntKeyTable *table = INT_KEY_TABLE_SET[t].load(std::memory_order_acquire);
+        if (table->logG == logG) {
+            return table;
+        }
+    }//for
+    return NULL;
+}
+
+
+const IntKeyTable& findIntKeyTable(double gamma, double logG) {
+
+    int count = INT_KEY_TABLE_COUNT.load(std::memory_order_acquire);
+    const IntKeyTable *table = searchIntKeyTables(logG, 0, count);
+
+    if (table == NULL) {
+        std::lock_guard<std::mutex> guard(INT_KEY_TABLE_LOCK);
+        int built = INT_KEY_TABLE_COUNT.load(std::memory_order_relaxed);
+        table = searchIntKeyTables(logG, count, built);
+
+        if (table == NULL && built < INT_KEY_TABLES) {
+            IntKeyTable *fresh = (IntKeyTable *)malloc(sizeof(IntKeyTable));
+            if (fresh == NULL) {
+                fprintf(stderr, "ERROR: unable to allocate the integer key table\n");
+                exit(1);
+            }
+            buildIntKeyTable(fresh, gamma, logG);
+            INT_KEY_TABLE_SET[built].store(fresh, std::memory_order_release);
+            INT_KEY_TABLE_COUNT.store(built + 1, std::memory_order_release);
+            table = fresh;
+        }
+    }//fi not yet published
+
+    if (table == NULL) {
+        if (PRIVATE_INT_KEYS == NULL) {
+            PRIVATE_INT_KEYS = (IntKeyTable *)malloc(sizeof(IntKeyTable));
+            if (PRIVATE_INT_KEYS == NULL) {
+                fprintf(stderr, "ERROR: unable to allocate the integer key table\n");
+                exit(1);
+            }
+            PRIVATE_INT_KEYS->logG = 0.0;
+        }
+        if (PRIVATE_INT_KEYS->logG != logG) {
+            buildIntKeyTable(PRIVATE_INT_KEYS, gamma, logG);
+        }
+        table = PRIVATE_INT_KEYS;
+    }//fi all the shared tables taken
+
+    LAST_INT_KEYS = table;
+    return *table;
+}
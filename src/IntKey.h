@@ -0,0 +1,72 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#ifndef __INTKEY_H__
+#define __INTKEY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+const int INT_KEY_TABLE_SIZE = 1 << 16;     // differences with a tabulated key (256 KB of keys)
+const int INT_KEY_TABLES = 256;             // resolutions tabulated at once, shared by every thread
+
+
+// Keys getKeyFor() gives to the differences 0 .. INT_KEY_TABLE_SIZE-1 at one resolution
+typedef struct IntKeyTable {
+    int keys[INT_KEY_TABLE_SIZE];
+    double logG;        // resolution the keys were computed at, 0 before the first build
+} IntKeyTable;
+
+
+void buildIntKeyTable(IntKeyTable *table, double gamma, double logG);
+
+// Table of the resolution logG, built on first use and never modified afterwards, so that
+// engines at different collapse levels and on different threads share it without rebuilds
+const IntKeyTable& findIntKeyTable(double gamma, double logG);
+
+extern thread_local const IntKeyTable *LAST_INT_KEYS;      // table this thread used last
+
+int getKeyFor(double value, double gamma, double logG);     // DDSketch.cc
+
+
+// |a - b| computed exactly: it always fits 32 unsigned bits
+inline uint32_t intDiff(int a, int b) {
+    return (a > b) ? (uint32_t)a - (uint32_t)b : (uint32_t)b - (uint32_t)a;
+}
+
+
+inline const IntKeyTable& getIntKeyTable(double gamma, double logG) {
+    const IntKeyTable *table = LAST_INT_KEYS;
+    if (table != NULL && table->logG == logG) {
+        return *table;
+    }
+    return findIntKeyTable(gamma, logG);
+}
+
+
+// Same key as getKeyFor((double)diff): differences past the table take the reference path
+inline int intKeyFor(uint32_t diff, const IntKeyTable& table, double gamma, double logG) {
+    if (diff < (uint32_t)INT_KEY_TABLE_SIZE) {
+        return table.keys[diff];
+    }
+    return getKeyFor((double)diff, gamma, logG);
+}
+
+
+#endif //__INTKEY_H__
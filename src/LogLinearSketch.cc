@@ -0,0 +1,123 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "LogLinearSketch.h"
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Memory management
+
+// Keeps the fewest mantissa bits m whose relative error 2^-(m+1) does not exceed alpha
+void initLogLinearSketch(LogLinearSketch *sketch, double alpha, int capacity) {
+
+    initDenseSketch(&sketch->dense, capacity);
+
+    int m = std::max(0, (int)std::ceil(-std::log2(alpha)) - 1);
+    m = std::min(m, LINEAR_MAX_MANTISSA_BITS);
+    sketch->shift = 52 - m;
+}
+
+
+void destroyLogLinearSketch(LogLinearSketch *sketch) {
+
+    if (sketch) {
+        destroyDenseSketch(&sketch->dense);
+    }//fi
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Queries
+
+// Bucket k holds the differences whose bit patterns lie in ((k-1)*2^shift, k*2^shift]:
+// their harmonic mean has the same relative error towards both ends
+double getLinearValue(int key, int shift) {
+
+    if (key == -MIN_KEY) {
+        return 0.0;
+    }
+
+    uint64_t loBits = (uint64_t)(key - 1) << shift;
+    uint64_t hiBits = (uint64_t)key << shift;
+    double lo, hi;
+    memcpy(&lo, &loBits, sizeof(lo));
+    memcpy(&hi, &hiBits, sizeof(hi));
+
+    return 2.0*lo*hi/(lo + hi);
+}
+
+
+double estimator(LogLinearSketch& mySketch, double q, double gamma) {
+    return getLinearValue(seekRankCursor(mySketch.dense, q), mySketch.shift);
+}
+
+
+double estimateQ(LogLinearSketch& Sketch, double q, double gamma, long n) {
+
+    double fraction = q*(n-1);
+    double estimate = getLinearValue(seekRankCursor(Sketch.dense, fraction), Sketch.shift);
+
+    #ifdef DEBUG
+        std::cout << "Quantile: " << estimate << ", population " << n << ", fraction " << fraction<< std::endl;
+    #endif
+
+    return estimate;
+}
+
+
+void debugSketch(LogLinearSketch& mySketch) {
+
+    fprintf(stdout,"\nLog-linear sketch, %d mantissa bits", 52 - mySketch.shift);
+    debugSketch(mySketch.dense);
+}
+
+
+int getSketchBuckets(LogLinearSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity) {
+
+    DenseSketch& dense = mySketch.dense;
+    if (dense.bins > capacity) {
+        return -1;
+    }
+
+    int b = 0;
+    if (dense.zeroCount) {
+        values[b] = 0.0;
+        counts[b] = dense.zeroCount;
+        ++b;
+    }
+    for (int i = dense.lo; i <= dense.hi; ++i) {
+        if (dense.counts[i]) {
+            values[b] = getLinearValue(dense.offset + i, mySketch.shift);
+            counts[b] = dense.counts[i];
+            ++b;
+        }
+    }//for
+    return b;
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Uniform Collapse of the sketch
+
+// ceil(ceil(bits/2^shift)/2) = ceil(bits/2^(shift+1)): the dense collapse drops one mantissa
+// bit. Past the exponent bits every difference already shares bucket 1.
+void collapseUniformly(LogLinearSketch& mySketch) {
+
+    collapseUniformly(mySketch.dense);
+    if (mySketch.shift < 63) {
+        ++mySketch.shift;
+    }
+}
@@ -0,0 +1,134 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#ifndef __LOGLINEARSKETCH_H__
+#define __LOGLINEARSKETCH_H__
+
+#include "DenseSketch.h"
+
+#include <stdint.h>
+#include <string.h>
+
+const int LINEAR_MAX_MANTISSA_BITS = 19;   // keys of finite doubles stay below MIN_KEY = 2^30
+
+
+// HDR histogram style bucketing: the key of a difference is its IEEE-754 bit pattern
+// divided by 2^shift and rounded up, i.e. its exponent followed by the top 52 - shift
+// mantissa bits, taken with no logarithm. Every octave holds 2^(52-shift) buckets of
+// equal width, so the relative error is at most 2^-(53-shift): for a given alpha it
+// takes between 0.5/alpha and 1/alpha buckets per octave, against 0.35/alpha for the
+// logarithmic buckets of DDSketch. The counts are kept in a DenseSketch: its collapse
+// of bucket k into ceil(k/2) is exactly the bucketing with one mantissa bit less.
+typedef struct LogLinearSketch {
+    DenseSketch dense;
+    int shift;
+} LogLinearSketch;
+
+
+
+void initLogLinearSketch(LogLinearSketch *sketch, double alpha, int capacity);
+
+void destroyLogLinearSketch(LogLinearSketch *sketch);
+
+double getLinearValue(int key, int shift);
+
+
+inline int getLinearKey(double value, int shift) {
+
+    if (value <= NULLBOUND) {
+        return -MIN_KEY;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (int)(((bits - 1) >> shift) + 1);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ Bin access
+
+inline void incrementBinCount(int key, LogLinearSketch& sketch) {
+    incrementBinCount(key, sketch.dense);
+}
+
+
+inline int decreaseBinCount(int key, LogLinearSketch& sketch) {
+    return decreaseBinCount(key, sketch.dense);
+}
+
+
+inline void incrementBinCount(int key, BinCount count, LogLinearSketch& sketch) {
+    incrementBinCount(key, count, sketch.dense);
+}
+
+
+inline int decreaseBinCount(int key, BinCount count, LogLinearSketch& sketch) {
+    return decreaseBinCount(key, count, sketch.dense);
+}
+
+
+inline int getSketchSize(LogLinearSketch& sketch) {
+    return sketch.dense.bins;
+}
+
+
+inline BinCount getSketchPopulation(LogLinearSketch& sketch) {
+    return getSketchPopulation(sketch.dense);
+}
+
+
+inline int fitSketchKeys(LogLinearSketch& sketch, int minKey, int maxKey, int maxSpan) {
+    return fitSketchKeys(sketch.dense, minKey, maxKey, maxSpan);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ Bucketing
+
+inline int getSketchKey(LogLinearSketch& sketch, double value, double gamma, double logG) {
+    return getLinearKey(value, sketch.shift);
+}
+
+
+inline int getIntSketchKey(LogLinearSketch& sketch, uint32_t diff, double gamma, double logG) {
+    return getLinearKey((double)diff, sketch.shift);
+}
+
+
+template <class T>
+inline int getSketchKeyDeltas(LogLinearSketch& sketch, const T *window, int from, int to, T new_item, T old_item, double gamma, double logG, int *keysA, int *keysR) {
+    return computeLinearKeyDeltas(window, from, to, new_item, old_item, sketch.shift, keysA, keysR);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ Queries and Collapse
+
+double estimator(LogLinearSketch& mySketch, double q, double gamma);
+
+double estimateQ(LogLinearSketch& Sketch, double q, double gamma, long n);
+
+void debugSketch(LogLinearSketch& mySketch);
+
+int getSketchBuckets(LogLinearSketch& mySketch, double gamma, double *values, BinCount *counts, int capacity);
+
+void collapseUniformly(LogLinearSketch& mySketch);
+
+
+#endif //__LOGLINEARSKETCH_H__
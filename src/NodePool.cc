@@ -0,0 +1,70 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#include "NodePool.h"
+#include <iostream>
+#include <stdlib.h>
+
+
+// a chunk starts with the link to the next one, padded to keep the nodes aligned
+const size_t CHUNK_HEADER = alignof(std::max_align_t);
+
+
+void initNodePool(NodePool *pool, int chunkNodes) {
+
+    pool->freeList = NULL;
+    pool->chunks = NULL;
+    pool->nodeSize = 0;
+    pool->chunkNodes = chunkNodes;
+
+    pool->nodes = 0;
+    pool->chunkCount = 0;
+}
+
+
+void destroyNodePool(NodePool *pool) {
+
+    while (pool->chunks) {
+        void *next = *(void **)pool->chunks;
+        free(pool->chunks);
+        pool->chunks = next;
+    }//wend
+
+    pool->freeList = NULL;
+    pool->nodes = 0;
+    pool->chunkCount = 0;
+}
+
+
+void growNodePool(NodePool& pool) {
+
+    char *chunk = (char *)malloc(CHUNK_HEADER + pool.chunkNodes*pool.nodeSize);
+    if (chunk == NULL) {
+        std::cerr << "ERROR: unable to grow the node pool" << std::endl;
+        exit(1);
+    }
+
+    *(void **)chunk = pool.chunks;
+    pool.chunks = chunk;
+
+    char *node = chunk + CHUNK_HEADER;
+    for (int i = 0; i < pool.chunkNodes; ++i, node += pool.nodeSize) {
+        releaseNode(pool, node);
+    }//for
+
+    pool.nodes += pool.chunkNodes;
+    ++pool.chunkCount;
+}
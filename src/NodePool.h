@@ -0,0 +1,122 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __NODEPOOL_H__
+#define __NODEPOOL_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+const int NODE_POOL_CHUNK = 1024;      // nodes allocated at once when the free list is empty
+
+
+// Free list of fixed-size nodes carved from malloc'ed chunks, owned by one sketch
+// (and so by one engine): nodes are never returned to the heap before
+// destroyNodePool(), so once the pool has grown to the peak sketch size the
+// containers drawing from it stop allocating.
+// The node size is fixed by the first allocation; larger requests bypass the pool.
+typedef struct NodePool {
+    void *freeList;
+    void *chunks;           // singly linked through their first word
+    size_t nodeSize;
+    int chunkNodes;
+
+    long nodes;             // nodes carved so far
+    long chunkCount;
+} NodePool;
+
+
+
+void initNodePool(NodePool *pool, int chunkNodes);
+
+void destroyNodePool(NodePool *pool);
+
+void growNodePool(NodePool& pool);
+
+
+inline bool fitsNodePool(NodePool& pool, size_t size) {
+    return pool.nodeSize == 0 || size <= pool.nodeSize;
+}
+
+
+inline void *allocateNode(NodePool& pool, size_t size) {
+
+    if (pool.nodeSize == 0) {
+        size_t align = alignof(std::max_align_t);
+        pool.nodeSize = ((std::max(size, sizeof(void *)) + align - 1)/align)*align;
+    }
+    if (pool.freeList == NULL) {
+        growNodePool(pool);
+    }
+
+    void *node = pool.freeList;
+    pool.freeList = *(void **)node;
+    return node;
+}
+
+
+inline void releaseNode(NodePool& pool, void *node) {
+    *(void **)node = pool.freeList;
+    pool.freeList = node;
+}
+
+
+
+// STL allocator over a NodePool: single objects come from the pool, arrays and
+// objects larger than its nodes from the heap. Without a pool it is std::allocator.
+template <class T>
+struct PoolAllocator {
+
+    typedef T value_type;
+
+    NodePool *pool;
+
+    PoolAllocator(NodePool *pool = NULL) : pool(pool) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T *allocate(size_t n) {
+        if (pool && n == 1 && fitsNodePool(*pool, sizeof(T))) {
+            return (T *)allocateNode(*pool, sizeof(T));
+        }
+        return (T *)::operator new(n*sizeof(T));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (pool && n == 1 && fitsNodePool(*pool, sizeof(T))) {
+            releaseNode(*pool, p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+};
+
+
+template <class T, class U>
+inline bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {
+    return a.pool == b.pool;
+}
+
+template <class T, class U>
+inline bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {
+    return a.pool != b.pool;
+}
+
+
+#endif //__NODEPOOL_H__
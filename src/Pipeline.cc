@@ -0,0 +1,222 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#include "Pipeline.h"
+
+#include <chrono>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Batch ring
+
+// A stage may wait for a whole batch of another, so past the pauses and yields of
+// spinWait() it naps, leaving the core to the stage it waits for
+static inline void waitStage(int *spins) {
+
+    if (*spins < SPIN_LIMIT + PIPE_YIELDS) {
+        spinWait(spins);
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(PIPE_NAP_US));
+    }
+}
+
+
+void initBatchRing(BatchRing *ring, int slots, size_t batchBytes) {
+
+    ring->producer.handed.store(0);
+    ring->producer.seen = 0;
+    ring->consumer.handed.store(0);
+    ring->consumer.seen = 0;
+    ring->slots = slots;
+    ring->batchBytes = (batchBytes + MEMORY_ALIGNMENT - 1)/MEMORY_ALIGNMENT*MEMORY_ALIGNMENT;
+    ring->batches = (char *)allocateAligned(slots*ring->batchBytes);
+    ring->counts = (long *)allocateAligned(slots*sizeof(long));
+}
+
+
+void destroyBatchRing(BatchRing *ring) {
+
+    free(ring->batches);
+    free(ring->counts);
+}
+
+
+void *claimBatch(BatchRing *ring) {
+
+    long tail = ring->producer.handed.load(std::memory_order_relaxed);
+    int spins = 0;
+    while (tail - ring->producer.seen == ring->slots) {
+        ring->producer.seen = ring->consumer.handed.load(std::memory_order_acquire);
+        if (tail - ring->producer.seen == ring->slots) {
+            waitStage(&spins);
+        }
+    }//wend full
+    return ring->batches + (tail % ring->slots)*ring->batchBytes;
+}
+
+
+void publishBatch(BatchRing *ring, long count) {
+
+    long tail = ring->producer.handed.load(std::memory_order_relaxed);
+    ring->counts[tail % ring->slots] = count;
+    ring->producer.handed.store(tail + 1, std::memory_order_release);
+}
+
+
+void closeBatchRing(BatchRing *ring) {
+
+    claimBatch(ring);
+    publishBatch(ring, 0);
+}
+
+
+void *takeBatch(BatchRing *ring, long *count) {
+
+    long head = ring->consumer.handed.load(std::memory_order_relaxed);
+    int spins = 0;
+    while (head == ring->consumer.seen) {
+        ring->consumer.seen = ring->producer.handed.load(std::memory_order_acquire);
+        if (head == ring->consumer.seen) {
+            waitStage(&spins);
+        }
+    }//wend empty
+
+    *count = ring->counts[head % ring->slots];
+    if (*count == 0) {
+        return NULL;
+    }
+    return ring->batches + (head % ring->slots)*ring->batchBytes;
+}
+
+
+void releaseBatch(BatchRing *ring) {
+
+    long head = ring->consumer.handed.load(std::memory_order_relaxed);
+    ring->consumer.handed.store(head + 1, std::memory_order_release);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Stages
+
+static void runIngest(Pipeline *pipe) {
+
+    char *line = NULL;
+    size_t dim = 0;
+    bool more = true;
+    long left = pipe->maxItems;
+    while (more && left > 0) {
+
+        Value *items = (Value *)claimBatch(&pipe->items);
+        long n = 0;
+        long want = std::min(pipe->batch, left);
+        if (pipe->in != NULL) {
+            while (n < want && (more = (getline(&line, &dim, pipe->in) != -1))) {
+                items[n] = strtod(line, NULL);
+                ++n;
+            }//wend
+        } else {
+            for (; n < want; ++n) {
+                items[n] = pipe->draw();
+            }//for
+        }//fi source
+
+        if (n > 0) {
+            publishBatch(&pipe->items, n);
+            left -= n;
+        }
+    }//wend batches
+    closeBatchRing(&pipe->items);
+
+    free(line);
+}
+
+
+static void runEmit(Pipeline *pipe) {
+
+    long count;
+    const Item *results;
+    while ((results = (const Item *)takeBatch(&pipe->results, &count)) != NULL) {
+        for (long i = 0; i < count; ++i) {
+            logItem(pipe->out, &results[i]);
+            results[i].isOutlier ? ++pipe->outliers : ++pipe->inliers;
+        }//for
+        releaseBatch(&pipe->results);
+    }//wend batches
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Pipeline
+
+int startPipeline(Pipeline *pipe, Counters *stats, long batch, int s, int sketchBound) {
+
+    pipe->in = NULL;
+    if (stats->filename != NULL) {
+        pipe->in = fopen(stats->filename, "r");
+        if (pipe->in == NULL) {
+            fprintf(stderr, "Error opening %s\n", stats->filename);
+            return 1;
+        }
+    } else {
+        pipe->draw = getStreamDistribution(stats);
+    }//fi source
+    pipe->maxItems = stats->MaxStreamLen;
+
+    char fname[FSIZE];
+    getCompareFilename(stats, s, sketchBound, fname);
+    pipe->out = fopen(fname, "w");
+    if (pipe->out == NULL) {
+        fprintf(stderr, "Error opening %s\n", fname);
+        if (pipe->in != NULL) {
+            fclose(pipe->in);
+        }
+        return 1;
+    }
+    pipe->outliers = 0;
+    pipe->inliers = 0;
+
+    pipe->batch = batch;
+    initBatchRing(&pipe->items, PIPE_SLOTS, batch*sizeof(Value));
+    initBatchRing(&pipe->results, PIPE_SLOTS, batch*sizeof(Item));
+
+    pipe->ingest = std::thread(runIngest, pipe);
+    pipe->emit = std::thread(runEmit, pipe);
+    return 0;
+}
+
+
+void passResults(Pipeline *pipe, long count) {
+
+    releaseBatch(&pipe->items);
+    if (count > 0) {
+        publishBatch(&pipe->results, count);
+    }
+}
+
+
+void finishPipeline(Pipeline *pipe) {
+
+    closeBatchRing(&pipe->results);
+    pipe->ingest.join();
+    pipe->emit.join();
+
+    if (pipe->in != NULL) {
+        fclose(pipe->in);
+    }
+    fclose(pipe->out);
+    destroyBatchRing(&pipe->items);
+    destroyBatchRing(&pipe->results);
+}
@@ -0,0 +1,117 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "Utility.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+const int PIPE_SLOTS = 8;           // batches in flight between two stages
+const int PIPE_YIELDS = 64;         // yields of a waiting stage, past SPIN_LIMIT pauses, before it naps
+const int PIPE_NAP_US = 50;
+
+
+// One side of a ring, alone in its cache line: the batches it has handed over, and the
+// last count of the other side it read, so that it only reads the other line when stuck
+typedef struct RingEnd {
+    std::atomic<long> handed;
+    long seen;
+    char pad[MEMORY_ALIGNMENT - sizeof(std::atomic<long>) - sizeof(long)];
+} RingEnd;
+
+
+// Bounded single producer, single consumer ring of batches. The producer fills the batch
+// it claims and publishes it, the consumer takes the oldest published one and releases it
+// once read. Each side writes its own count only, so the hand-off takes no lock and costs
+// a cache line transfer per batch. A published batch of 0 items ends the stream.
+typedef struct BatchRing {
+    RingEnd producer;           // batches published
+    RingEnd consumer;           // batches released
+    int slots;
+    size_t batchBytes;
+    char *batches;
+    long *counts;
+} BatchRing;
+
+
+void initBatchRing(BatchRing *ring, int slots, size_t batchBytes);
+
+void destroyBatchRing(BatchRing *ring);
+
+// Producer: waits for a free batch and returns it, the same one until it is published
+void *claimBatch(BatchRing *ring);
+
+void publishBatch(BatchRing *ring, long count);
+
+// Producer: publishes the end of the stream
+void closeBatchRing(BatchRing *ring);
+
+// Consumer: waits for the oldest published batch and returns it with its count, or NULL
+// at the end of the stream
+void *takeBatch(BatchRing *ring, long *count);
+
+void releaseBatch(BatchRing *ring);
+
+
+
+// -p batch: the stream read or drawn by an ingest thread, processed by the caller and its
+// estimates written by an output thread, the three stages handing over batches of up to
+// batch items through two rings. Memory is bounded by the rings whatever the stream length.
+typedef struct Pipeline {
+    BatchRing items;            // Value batches, ingest to engine
+    BatchRing results;          // Item batches, engine to output
+    long batch;
+
+    FILE *in;                   // the -f file, or NULL to draw from the -d distribution
+    std::function<double()> draw;
+    long maxItems;
+    std::thread ingest;
+
+    FILE *out;                  // the -o cmp log
+    long outliers;
+    long inliers;
+    std::thread emit;
+} Pipeline;
+
+
+
+// Opens the stream of stats and its Results/ log for windows of s items and a sketch of
+// sketchBound buckets, and starts the ingest and output threads. Returns 0, or 1 if a file
+// cannot be opened.
+int startPipeline(Pipeline *pipe, Counters *stats, long batch, int s, int sketchBound);
+
+// Engine stage: the next batch of items and its count, or NULL at the end of the stream;
+// its results go to the batch of nextResults(), which holds as many Items
+inline const Value *nextItems(Pipeline *pipe, long *count) {
+    return (const Value *)takeBatch(&pipe->items, count);
+}
+
+inline Item *nextResults(Pipeline *pipe) {
+    return (Item *)claimBatch(&pipe->results);
+}
+
+// Hands the results of the last batch of items over to the output thread
+void passResults(Pipeline *pipe, long count);
+
+// Ends the stream of results, waits for the ingest and output threads and closes the files
+void finishPipeline(Pipeline *pipe);
+
+
+#endif //__PIPELINE_H__
@@ -0,0 +1,91 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "Policies.h"
+#include <cstring>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Output policies
+
+void CompareOutput::open(Counters *stats) {
+
+    loggedPoints = (Item *)malloc(sizeof(Item)* stats->streamLen); 
+    pIdx = 0;
+}
+
+
+void CompareOutput::close(Counters *stats, int s, int sketchBound) {
+
+    char fname[FSIZE];
+    getCompareFilename(stats, s, sketchBound, fname);
+        
+    FILE *logF = fopen(fname, "w");
+    if (logF != NULL) {
+        
+        for(long u = 0; u<pIdx; ++u) {
+            logItem(logF, &loggedPoints[u]);
+        }//for 
+
+        fclose(logF);
+    }//fi
+    free(loggedPoints);
+}
+
+
+void BufferedOutput::open(Counters *stats) {
+    openOutlierBuffers(stats);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Validation policies
+
+template <bool Trace>
+void ExactValidationT<Trace>::open(Counters *stats, int s, int sketchBound, int diff_fraction) {
+
+    initExactFilename(stats, s, sketchBound);
+
+    int h = s/2 + 1;                               
+    kth = (long)h*(h-1)/2;                           
+    I = (long)s*(s-1)/2;                             
+    ExactDiffs.assign(I, 0);
+    dd = 0;                                       
+
+    char qfilename[FSIZE];
+    std::string name = stats->filename;
+    std::size_t from_p = name.find_last_of("/"); 
+    std::string distr = name.substr(from_p+1, 4); 
+    snprintf(qfilename, FSIZE-1, "./Quantiles-%s-%d-%d.csv", distr.c_str(), s, diff_fraction);
+        
+    qfile = fopen(qfilename, "w");
+    if (qfile == NULL){
+        fprintf(stderr,"Error opening %s\n", qfilename);
+        exit(1);       
+    }//fi
+    fprintf(qfile, "Population,Bins,Collapses,EMin,Amin,err,index,EQ1,AQ1,err,index,EQ2,AQ2,err,index,EQ3,AQ3,err,index,EMax,AMax,err,index\n");
+}
+
+
+template <bool Trace>
+void ExactValidationT<Trace>::close() {
+    fclose(qfile);
+}
+
+
+template struct ExactValidationT<false>;
+template struct ExactValidationT<true>;
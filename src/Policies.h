@@ -0,0 +1,184 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#ifndef __POLICIES_H__
+#define __POLICIES_H__
+
+#include "DDSketch.h"
+#include "QuickSelect.h"
+#include "Utility.h"
+
+
+// Execution policies of the main loop, which is instantiated for every combination of
+// them: their per-item members are inline, so a mode costs nothing in the modes it is
+// not part of. The selection policies (NearestSelection, UniformSelection) are in DDSketch.h.
+
+
+//****** ****** ****** ****** ****** ************ Output policies: where the estimates go
+
+// -o cmp: one row per item, written to Results/<stream>-<s>-<bound>.csv at the end
+typedef struct CompareOutput {
+    Item *loggedPoints;
+    long pIdx;
+
+    static const char *name() { return "cmp"; }
+
+    void open(Counters *stats);
+    void close(Counters *stats, int s, int sketchBound);
+
+    template <class SketchT>
+    inline void record(Counters *stats, SketchT& Sketch, long seq, double middle, double median, double estimatedQ, int collapses, double alpha) {
+
+        Item& point = loggedPoints[pIdx];
+        point.seq = seq;
+        point.middle = middle;
+        point.median = median;
+        point.Qn = stats->QnScale * estimatedQ;
+        point.collapses = collapses;
+        point.alpha = alpha;
+        point.bins = getSketchSize(Sketch);
+
+        if ( (fabs(middle - median) - (3 * point.Qn)) > 0 ){
+            point.isOutlier = 1;
+            ++(stats->approx_out_count);
+        }else{
+            point.isOutlier = 0;
+            ++(stats->approx_in_count);
+        }//fi check
+
+        ++pIdx;
+    }
+} CompareOutput;
+
+
+// -o buffer: sequence numbers and items of outliers and inliers kept in memory, written by closeLog()
+typedef struct BufferedOutput {
+
+    static const char *name() { return "buffer"; }
+
+    void open(Counters *stats);
+    void close(Counters *stats, int s, int sketchBound) {}
+
+    template <class SketchT>
+    inline void record(Counters *stats, SketchT& Sketch, long seq, double middle, double median, double estimatedQ, int collapses, double alpha) {
+        OutlierTest(middle, seq, median, estimatedQ, stats, collapses, alpha);
+    }
+} BufferedOutput;
+
+
+// -o file: outliers and inliers written with their estimates as they are found
+typedef struct FileOutput {
+
+    static const char *name() { return "file"; }
+
+    void open(Counters *stats) {}
+    void close(Counters *stats, int s, int sketchBound) {}
+
+    template <class SketchT>
+    inline void record(Counters *stats, SketchT& Sketch, long seq, double middle, double median, double estimatedQ, int collapses, double alpha) {
+        checkForOutlier(middle, seq, median, estimatedQ, stats, alpha, collapses, getSketchSize(Sketch));
+    }
+} FileOutput;
+
+
+
+//****** ****** ****** ****** ****** ************ Validation policies: what is checked against the exact differences
+
+// -v none: processing only
+typedef struct NoValidation {
+
+    static const bool exact = false;
+    static const char *banner() { return "-----> TESTING MODE <-----"; }
+
+    void open(Counters *stats, int s, int sketchBound, int diff_fraction) {}
+    void close() {}
+
+    template <class T>
+    inline void fill(const T *window, int pos) {}
+
+    template <class SketchT>
+    inline void logSketch(SketchT& Sketch, int collapses, double gamma) {}
+
+    template <class SketchT, class T>
+    inline void update(const T *window, int pos, int s, T oldest_item, SketchT& Sketch, int collapses, double gamma) {}
+
+    template <class SketchT>
+    inline void check(Counters *stats, SketchT& Sketch, long seq, double middle, double median, double estimatedQ, int collapses, double alpha) {}
+} NoValidation;
+
+
+// -v exact: all the s(s-1)/2 differences are kept, the sketch quantiles logged against
+// theirs after every item and the outliers classified with the exact Qn as well.
+// Trace also prints the relative error of every estimate.
+template <bool Trace>
+struct ExactValidationT {
+
+    std::vector<double> ExactDiffs;
+    int dd;
+    long I;
+    long kth;
+    FILE *qfile;
+
+    static const bool exact = true;
+    static const char *banner() { return Trace ? "***** DEBUG MODE *****" : "++++++ CHECK MODE ++++++"; }
+
+    void open(Counters *stats, int s, int sketchBound, int diff_fraction);
+    void close();
+
+    template <class T>
+    inline void fill(const T *window, int pos) {
+        for(int j = pos-1; j>=0; --j) { 
+            ExactDiffs[dd] = std::abs(window[pos]-window[j]);
+            ++dd;
+        }//for
+    }
+
+    template <class SketchT>
+    inline void logSketch(SketchT& Sketch, int collapses, double gamma) {
+        logQuantiles(qfile, Sketch, collapses, gamma, ExactDiffs.data(), I);
+    }
+
+    template <class SketchT, class T>
+    inline void update(const T *window, int pos, int s, T oldest_item, SketchT& Sketch, int collapses, double gamma) {
+
+        for(int l=1; l<s; ++l) {                                                      
+            int id = (pos+l)%s; 
+            double new_diff = std::abs(window[pos] - window[id]);
+            double old_diff = std::abs(oldest_item - window[id]);
+            std::vector<double>::iterator it = std::find(ExactDiffs.begin(), ExactDiffs.end(), old_diff);
+            if (it != ExactDiffs.end()){
+                *(it) = new_diff;
+            }//fi
+        }//for l
+        logSketch(Sketch, collapses, gamma);
+    }
+
+    template <class SketchT>
+    inline void check(Counters *stats, SketchT& Sketch, long seq, double middle, double median, double estimatedQ, int collapses, double alpha) {
+
+        double exact_kth = quickselect(ExactDiffs.data(), I, kth-1 );
+        double errQ = checkApproximationError(estimatedQ, exact_kth, "k-th order stat", Trace);   
+        exactOutlier(middle, seq, median, exact_kth, stats, estimatedQ, errQ, alpha, collapses, getSketchSize(Sketch));
+    }
+};
+
+typedef ExactValidationT<false> ExactValidation;
+typedef ExactValidationT<true> TraceValidation;
+
+
+#endif //__POLICIES_H__
@@ -0,0 +1,234 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#include "Publisher.h"
+#include "DenseSketch.h"
+#include "FenwickSketch.h"
+#include "SketchPyramid.h"
+#include "LogLinearSketch.h"
+
+#include <cstring>
+#include <new>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Seqlock
+
+static inline void beginWrite(std::atomic<unsigned long>& version) {
+
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+
+static inline void endWrite(std::atomic<unsigned long>& version) {
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+// Even version to read at, 0 if nothing was written yet
+static inline unsigned long beginRead(const std::atomic<unsigned long>& version) {
+
+    unsigned long v;
+    int spins = 0;
+    while ((v = version.load(std::memory_order_acquire)) & 1) {
+        spinWait(&spins);
+    }//wend writing
+    return v;
+}
+
+
+static inline bool endRead(const std::atomic<unsigned long>& version, unsigned long v) {
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) == v;
+}
+
+
+static inline uint64_t toWord(double x) {
+    uint64_t w;
+    memcpy(&w, &x, sizeof(w));
+    return w;
+}
+
+
+static inline double fromWord(uint64_t w) {
+    double x;
+    memcpy(&x, &w, sizeof(x));
+    return x;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Writer
+
+int initPublisher(Publisher *pub, int every, int capacity) {
+
+    if (every < 1) {
+        return 1;
+    }
+
+    pub->every = every;
+    pub->countdown = every;
+    pub->capacity = capacity;
+    pub->served = 0;
+    pub->values = (double *)allocateAligned(capacity*sizeof(double));
+    pub->counts = (BinCount *)allocateAligned(capacity*sizeof(BinCount));
+
+    pub->resultVersion.store(0);
+    for (int w = 0; w < RESULT_WORDS; ++w) {
+        pub->result[w].store(0);
+    }//for
+    pub->requests.store(0);
+    pub->sketchVersion.store(0);
+
+    int words = SKETCH_HEADER_WORDS + 2*capacity;
+    pub->sketch = (std::atomic<uint64_t> *)allocateAligned(words*sizeof(std::atomic<uint64_t>));
+    for (int w = 0; w < words; ++w) {
+        new (&pub->sketch[w]) std::atomic<uint64_t>(0);
+    }//for
+    return 0;
+}
+
+
+void destroyPublisher(Publisher *pub) {
+
+    free(pub->values);
+    free(pub->counts);
+    free(pub->sketch);
+}
+
+
+void publishResult(Publisher *pub, const Item *result) {
+
+    uint64_t words[RESULT_WORDS] = {0};
+    memcpy(words, result, sizeof(Item));
+
+    beginWrite(pub->resultVersion);
+    for (int w = 0; w < RESULT_WORDS; ++w) {
+        pub->result[w].store(words[w], std::memory_order_relaxed);
+    }//for
+    endWrite(pub->resultVersion);
+}
+
+
+template <class SketchT>
+void publishSketch(Publisher *pub, SketchT& Sketch, long seq, int collapses, double alpha, double gamma, BinCount population) {
+
+    unsigned long requests = pub->requests.load(std::memory_order_relaxed);
+    int bins = getSketchBuckets(Sketch, gamma, pub->values, pub->counts, pub->capacity);
+    if (bins < 0) {
+        return;
+    }
+
+    std::atomic<uint64_t> *words = pub->sketch;
+    beginWrite(pub->sketchVersion);
+    words[0].store(seq, std::memory_order_relaxed);
+    words[1].store(collapses, std::memory_order_relaxed);
+    words[2].store(bins, std::memory_order_relaxed);
+    words[3].store(toWord(alpha), std::memory_order_relaxed);
+    words[4].store(toWord(gamma), std::memory_order_relaxed);
+    words[5].store(population, std::memory_order_relaxed);
+    words += SKETCH_HEADER_WORDS;
+    for (int b = 0; b < bins; ++b) {
+        words[b].store(toWord(pub->values[b]), std::memory_order_relaxed);
+        words[pub->capacity + b].store(pub->counts[b], std::memory_order_relaxed);
+    }//for
+    endWrite(pub->sketchVersion);
+
+    pub->served = requests;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Readers
+
+int readResult(const Publisher *pub, Item *result) {
+
+    uint64_t words[RESULT_WORDS];
+    unsigned long v;
+    do {
+        v = beginRead(pub->resultVersion);
+        if (v == 0) {
+            return 0;
+        }
+        for (int w = 0; w < RESULT_WORDS; ++w) {
+            words[w] = pub->result[w].load(std::memory_order_relaxed);
+        }//for
+    } while (!endRead(pub->resultVersion, v));
+
+    memcpy(result, words, sizeof(Item));
+    return 1;
+}
+
+
+void requestSketch(Publisher *pub) {
+    pub->requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+long readSketch(const Publisher *pub, SketchCopy *copy) {
+
+    const std::atomic<uint64_t> *words = pub->sketch;
+    unsigned long v;
+    do {
+        v = beginRead(pub->sketchVersion);
+        if (v == 0) {
+            return 0;
+        }
+        copy->seq = words[0].load(std::memory_order_relaxed);
+        copy->collapses = words[1].load(std::memory_order_relaxed);
+        copy->bins = std::min((int)words[2].load(std::memory_order_relaxed), copy->capacity);
+        copy->alpha = fromWord(words[3].load(std::memory_order_relaxed));
+        copy->gamma = fromWord(words[4].load(std::memory_order_relaxed));
+        copy->population = words[5].load(std::memory_order_relaxed);
+        const std::atomic<uint64_t> *buckets = words + SKETCH_HEADER_WORDS;
+        for (int b = 0; b < copy->bins; ++b) {
+            copy->values[b] = fromWord(buckets[b].load(std::memory_order_relaxed));
+            copy->counts[b] = buckets[pub->capacity + b].load(std::memory_order_relaxed);
+        }//for
+    } while (!endRead(pub->sketchVersion, v));
+
+    return v/2;
+}
+
+
+void initSketchCopy(SketchCopy *copy, const Publisher *pub) {
+
+    copy->bins = 0;
+    copy->capacity = pub->capacity;
+    copy->values = (double *)allocateAligned(pub->capacity*sizeof(double));
+    copy->counts = (BinCount *)allocateAligned(pub->capacity*sizeof(BinCount));
+}
+
+
+void destroySketchCopy(SketchCopy *copy) {
+
+    free(copy->values);
+    free(copy->counts);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Instantiations
+
+#define INSTANTIATE_PUBLISHER_OPS(SketchT) \
+    template void publishSketch<SketchT>(Publisher *, SketchT&, long, int, double, double, BinCount);
+
+INSTANTIATE_PUBLISHER_OPS(MapSketch)
+INSTANTIATE_PUBLISHER_OPS(DenseSketch)
+INSTANTIATE_PUBLISHER_OPS(FenwickSketch)
+INSTANTIATE_PUBLISHER_OPS(SketchPyramid)
+INSTANTIATE_PUBLISHER_OPS(LogLinearSketch)
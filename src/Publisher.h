@@ -0,0 +1,116 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#ifndef __PUBLISHER_H__
+#define __PUBLISHER_H__
+
+#include "DDSketch.h"
+#include "Utility.h"
+
+#include <atomic>
+#include <stdint.h>
+
+const int RESULT_WORDS = (sizeof(Item) + sizeof(uint64_t) - 1)/sizeof(uint64_t);
+const int SKETCH_HEADER_WORDS = 6;      // seq, collapses, bins, alpha, gamma, population
+
+
+// Copy of the sketch as published: the value and count of every non-empty bucket
+typedef struct SketchCopy {
+    long seq;                   // of the result the copy was taken with
+    int collapses;
+    double alpha;
+    double gamma;
+    BinCount population;
+    int bins;
+    int capacity;
+    double *values;             // ascending, 0 for the null differences
+    BinCount *counts;
+} SketchCopy;
+
+
+// Latest result of an engine for any number of reader threads, and a copy of its sketch
+// on demand, each behind a seqlock: the writer makes the version odd, stores the words and
+// makes it even again, a reader copies the words and retries if the version was odd or has
+// moved meanwhile. The writer never waits for the readers, and a reader never returns a
+// mix of two results. The words are relaxed atomics, so the copies are no data race.
+typedef struct Publisher {
+    // writer only
+    int every;                  // items per published result
+    int countdown;              // items before the next one
+    int capacity;               // buckets a sketch copy holds
+    unsigned long served;       // sketch requests answered
+    double *values;
+    BinCount *counts;
+    char pad0[MEMORY_ALIGNMENT];
+
+    std::atomic<unsigned long> resultVersion;
+    std::atomic<uint64_t> result[RESULT_WORDS];
+    char pad1[MEMORY_ALIGNMENT];
+
+    std::atomic<unsigned long> requests;        // sketch copies asked by readers
+    char pad2[MEMORY_ALIGNMENT];
+
+    std::atomic<unsigned long> sketchVersion;
+    std::atomic<uint64_t> *sketch;              // header, capacity values, capacity counts
+} Publisher;
+
+
+
+// A result every `every` items (>= 1), sketch copies of up to capacity buckets; returns 0,
+// or 1 if every < 1
+int initPublisher(Publisher *pub, int every, int capacity);
+
+void destroyPublisher(Publisher *pub);
+
+
+// Writer: true once every `every` calls, when the result of the item is to be published
+inline bool isPublicationDue(Publisher *pub) {
+
+    if (--pub->countdown > 0) {
+        return false;
+    }
+    pub->countdown = pub->every;
+    return true;
+}
+
+inline bool isSketchRequested(const Publisher *pub) {
+    return pub->requests.load(std::memory_order_relaxed) != pub->served;
+}
+
+void publishResult(Publisher *pub, const Item *result);
+
+// Writer: answers the pending requests with a copy of the sketch, unless it has more
+// buckets than the capacity, in which case they wait for a smaller one
+template <class SketchT>
+void publishSketch(Publisher *pub, SketchT& Sketch, long seq, int collapses, double alpha, double gamma, BinCount population);
+
+
+// Reader: the latest result; returns 0 if none was published yet
+int readResult(const Publisher *pub, Item *result);
+
+// Reader: asks the writer for a copy of the sketch with its next published result
+void requestSketch(Publisher *pub);
+
+// Reader: the latest copy of the sketch; returns the number of copies published so far,
+// 0 for none, so that a reader can tell a new copy from the one it has
+long readSketch(const Publisher *pub, SketchCopy *copy);
+
+void initSketchCopy(SketchCopy *copy, const Publisher *pub);
+
+void destroySketchCopy(SketchCopy *copy);
+
+
+#endif //__PUBLISHER_H__
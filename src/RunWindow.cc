@@ -0,0 +1,115 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#include "RunWindow.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdlib.h>
+
+
+template <class T>
+void initRunWindow(RunWindow<T> *w, int s) {
+
+    w->values = (T *)malloc(s*sizeof(T));
+    w->counts = (int *)malloc(s*sizeof(int));
+    if (w->values == NULL || w->counts == NULL) {
+        std::cerr << "ERROR: unable to allocate the run-length window" << std::endl;
+        exit(1);
+    }
+    w->runs = 0;
+    w->size = 0;
+}
+
+
+template <class T>
+void destroyRunWindow(RunWindow<T> *w) {
+
+    free(w->values);
+    free(w->counts);
+    w->values = NULL;
+    w->counts = NULL;
+    w->runs = 0;
+    w->size = 0;
+}
+
+
+template <class T>
+void insertRun(RunWindow<T>& w, T value) {
+
+    int r = std::lower_bound(w.values, w.values + w.runs, value) - w.values;
+    ++w.size;
+
+    if (r < w.runs && w.values[r] == value) {
+        ++w.counts[r];
+        return;
+    }
+
+    memmove(&w.values[r+1], &w.values[r], (w.runs - r)*sizeof(T));
+    memmove(&w.counts[r+1], &w.counts[r], (w.runs - r)*sizeof(int));
+    w.values[r] = value;
+    w.counts[r] = 1;
+    ++w.runs;
+}
+
+
+template <class T>
+void eraseRun(RunWindow<T>& w, T value) {
+
+    int r = std::lower_bound(w.values, w.values + w.runs, value) - w.values;
+    if (r == w.runs || w.values[r] != value) {
+        std::cerr << "ERROR while searching an existing item in Pwindow " << std::endl;
+        exit(1);
+    }
+    --w.size;
+
+    if (--w.counts[r]) {
+        return;
+    }
+
+    memmove(&w.values[r], &w.values[r+1], (w.runs - r - 1)*sizeof(T));
+    memmove(&w.counts[r], &w.counts[r+1], (w.runs - r - 1)*sizeof(int));
+    --w.runs;
+}
+
+
+template <class T>
+T runValueAt(RunWindow<T>& w, int rank) {
+
+    int r = 0;
+    while (rank >= w.counts[r]) {
+        rank -= w.counts[r];
+        ++r;
+    }//wend
+    return w.values[r];
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Instantiations
+
+#define INSTANTIATE_RUN_WINDOW_OPS(T) \
+    template void initRunWindow<T>(RunWindow<T> *, int); \
+    template void destroyRunWindow<T>(RunWindow<T> *); \
+    template void insertRun<T>(RunWindow<T>&, T); \
+    template void eraseRun<T>(RunWindow<T>&, T); \
+    template T runValueAt<T>(RunWindow<T>&, int);
+
+INSTANTIATE_RUN_WINDOW_OPS(double)
+INSTANTIATE_RUN_WINDOW_OPS(float)
+INSTANTIATE_RUN_WINDOW_OPS(int)
@@ -0,0 +1,54 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+
+#ifndef __RUNWINDOW_H__
+#define __RUNWINDOW_H__
+
+
+// Run-length sorted window: the distinct values in increasing order, each with the
+// number of its copies. Insert and erase move O(#runs) entries instead of O(s), and
+// the pairs of an item with all the others are visited once per distinct value.
+// Defined for T = double, float and int.
+template <class T>
+struct RunWindow {
+    T *values;
+    int *counts;
+    int runs;
+    int size;           // items, i.e. the sum of the counts
+};
+
+
+
+template <class T>
+void initRunWindow(RunWindow<T> *w, int s);
+
+template <class T>
+void destroyRunWindow(RunWindow<T> *w);
+
+template <class T>
+void insertRun(RunWindow<T>& w, T value);
+
+template <class T>
+void eraseRun(RunWindow<T>& w, T value);
+
+// Value of the given rank among the items
+template <class T>
+T runValueAt(RunWindow<T>& w, int rank);
+
+
+#endif //__RUNWINDOW_H__
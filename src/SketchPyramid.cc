@@ -0,0 +1,101 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#include "SketchPyramid.h"
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Memory management
+
+void initSketchPyramid(SketchPyramid *sketch, double alpha, int capacity) {
+
+    for (int l = 0; l < PYRAMID_LEVELS; ++l) {
+        initDenseSketch(&sketch->levels[l], capacity);
+    }
+    sketch->active = 0;
+
+    sketch->baseAlpha = alpha;
+    sketch->baseGamma = getCurrentGamma(alpha);
+    sketch->baseLogG = getCurrentLogG(sketch->baseGamma);
+}
+
+
+void destroySketchPyramid(SketchPyramid *sketch) {
+
+    if (sketch) {
+        for (int l = 0; l < PYRAMID_LEVELS; ++l) {
+            destroyDenseSketch(&sketch->levels[l]);
+        }
+    }//fi
+}
+
+
+// The coarsest level collapsed once becomes levels[0], each other level is
+// the one below it collapsed once more. Costs O(PYRAMID_LEVELS * capacity)
+// every PYRAMID_LEVELS collapses.
+void rebaseSketchPyramid(SketchPyramid& sketch) {
+
+    DenseSketch top = sketch.levels[PYRAMID_LEVELS-1];
+    sketch.levels[PYRAMID_LEVELS-1] = sketch.levels[0];
+    sketch.levels[0] = top;
+    collapseUniformly(sketch.levels[0]);
+
+    for (int l = 1; l < PYRAMID_LEVELS; ++l) {
+        copyDenseSketch(sketch.levels[l], sketch.levels[l-1]);
+        collapseUniformly(sketch.levels[l]);
+    }//for
+
+    for (int l = 0; l < PYRAMID_LEVELS; ++l) {
+        sketch.baseAlpha = getCurrentAlpha(sketch.baseAlpha);
+    }//for
+    sketch.baseGamma = getCurrentGamma(sketch.baseAlpha);
+    sketch.baseLogG = getCurrentLogG(sketch.baseGamma);
+
+    sketch.active = 0;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Queries and Collapse
+
+double estimator(SketchPyramid& mySketch, double q, double gamma) {
+    return estimator(mySketch.levels[mySketch.active], q, gamma);
+}
+
+
+double estimateQ(SketchPyramid& Sketch, double q, double gamma, long n) {
+    return estimateQ(Sketch.levels[Sketch.active], q, gamma, n);
+}
+
+
+void debugSketch(SketchPyramid& mySketch) {
+    fprintf(stdout,"\nActive level %d of %d\n", mySketch.active, PYRAMID_LEVELS);
+    debugSketch(mySketch.levels[mySketch.active]);
+}
+
+
+int getSketchBuckets(SketchPyramid& mySketch, double gamma, double *values, BinCount *counts, int capacity) {
+    return getSketchBuckets(mySketch.levels[mySketch.active], gamma, values, counts, capacity);
+}
+
+
+void collapseUniformly(SketchPyramid& mySketch) {
+
+    if (mySketch.active + 1 < PYRAMID_LEVELS) {
+        ++mySketch.active;
+    } else {
+        rebaseSketchPyramid(mySketch);
+    }
+}
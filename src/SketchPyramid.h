@@ -0,0 +1,138 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __SKETCHPYRAMID_H__
+#define __SKETCHPYRAMID_H__
+
+#include "DenseSketch.h"
+
+const int PYRAMID_LEVELS = 4;
+
+
+// Dense sketches of the same differences at PYRAMID_LEVELS consecutive resolutions.
+// Keys are computed at the finest one (baseGamma) and bucket k lands on ceil(k/2^l)
+// at level l, the exact image of l uniform collapses: a collapse only moves the active
+// level up. Levels below the active one are no longer maintained; once the coarsest
+// level is active the next collapse rebuilds the pyramid on top of it (rebase).
+typedef struct SketchPyramid {
+    DenseSketch levels[PYRAMID_LEVELS];
+    int active;
+
+    double baseAlpha;   // parameters of levels[0]
+    double baseGamma;
+    double baseLogG;
+} SketchPyramid;
+
+
+
+void initSketchPyramid(SketchPyramid *sketch, double alpha, int capacity);
+
+void destroySketchPyramid(SketchPyramid *sketch);
+
+void rebaseSketchPyramid(SketchPyramid& sketch);
+
+
+
+//****** ****** ****** ****** ****** ************ Bin access
+
+inline int getLevelKey(int key, int level) {
+    return (key == -MIN_KEY) ? key : -((-key) >> level);
+}
+
+
+inline void incrementBinCount(int key, SketchPyramid& sketch) {
+    for (int l = sketch.active; l < PYRAMID_LEVELS; ++l) {
+        incrementBinCount(getLevelKey(key, l), sketch.levels[l]);
+    }
+}
+
+
+inline void incrementBinCount(int key, BinCount count, SketchPyramid& sketch) {
+    for (int l = sketch.active; l < PYRAMID_LEVELS; ++l) {
+        incrementBinCount(getLevelKey(key, l), count, sketch.levels[l]);
+    }
+}
+
+
+inline int decreaseBinCount(int key, SketchPyramid& sketch) {
+
+    int res = decreaseBinCount(getLevelKey(key, sketch.active), sketch.levels[sketch.active]);
+    if (res == 1) {
+        for (int l = sketch.active+1; l < PYRAMID_LEVELS; ++l) {
+            decreaseBinCount(getLevelKey(key, l), sketch.levels[l]);
+        }
+    }
+    return res;
+}
+
+
+inline int decreaseBinCount(int key, BinCount count, SketchPyramid& sketch) {
+
+    int res = decreaseBinCount(getLevelKey(key, sketch.active), count, sketch.levels[sketch.active]);
+    if (res == 1) {
+        for (int l = sketch.active+1; l < PYRAMID_LEVELS; ++l) {
+            decreaseBinCount(getLevelKey(key, l), count, sketch.levels[l]);
+        }
+    }
+    return res;
+}
+
+
+inline int getSketchSize(SketchPyramid& sketch) {
+    return sketch.levels[sketch.active].bins;
+}
+
+
+inline BinCount getSketchPopulation(SketchPyramid& sketch) {
+    return getSketchPopulation(sketch.levels[sketch.active]);
+}
+
+
+// The active level spans the most keys, the levels above it half as many each
+inline int fitSketchKeys(SketchPyramid& sketch, int minKey, int maxKey, int maxSpan) {
+    if (minKey > maxKey) {
+        return 1;
+    }
+    return fitSketchKeys(sketch.levels[sketch.active], getLevelKey(minKey, sketch.active), getLevelKey(maxKey, sketch.active), maxSpan);
+}
+
+
+inline double getKeyGamma(SketchPyramid& sketch, double gamma) {
+    return sketch.baseGamma;
+}
+
+
+inline double getKeyLogG(SketchPyramid& sketch, double logG) {
+    return sketch.baseLogG;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ Queries and Collapse
+
+double estimator(SketchPyramid& mySketch, double q, double gamma);
+
+double estimateQ(SketchPyramid& Sketch, double q, double gamma, long n);
+
+void debugSketch(SketchPyramid& mySketch);
+
+int getSketchBuckets(SketchPyramid& mySketch, double gamma, double *values, BinCount *counts, int capacity);
+
+void collapseUniformly(SketchPyramid& mySketch);
+
+
+#endif //__SKETCHPYRAMID_H__
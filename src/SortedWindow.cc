@@ -0,0 +1,229 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+#include "SortedWindow.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdlib.h>
+
+
+static void *allocateOrDie(size_t bytes) {
+
+    void *p = malloc(bytes);
+    if (p == NULL) {
+        std::cerr << "ERROR: unable to allocate the sorted window" << std::endl;
+        exit(1);
+    }
+    return p;
+}
+
+
+static void rebuildBlockIndex(SortedWindow& w) {
+
+    w.cacheBlock = 0;
+    w.cacheStart = 0;
+
+    w.tree[0] = 0;
+    for (int i = 1; i <= w.nblocks; ++i) {
+        w.tree[i] = w.sizes[i-1];
+    }//for
+    for (int i = 1; i <= w.nblocks; ++i) {
+        int parent = i + (i & (-i));
+        if (parent <= w.nblocks) {
+            w.tree[parent] += w.tree[i];
+        }
+    }//for
+}
+
+
+static void addToBlockIndex(SortedWindow& w, int b, int delta) {
+
+    w.cacheBlock = 0;       // block 0 always starts at rank 0
+    w.cacheStart = 0;
+    for (int i = b+1; i <= w.nblocks; i += i & (-i)) {
+        w.tree[i] += delta;
+    }
+}
+
+
+// First block whose largest value is not less than value, the last one if none
+static int findBlock(SortedWindow& w, double value) {
+
+    int b = std::lower_bound(w.lasts, w.lasts + w.nblocks, value) - w.lasts;
+    return std::min(b, w.nblocks - 1);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Memory management
+
+void initSortedWindow(SortedWindow *w, int s) {
+
+    w->maxBlocks = (4*s)/SORTED_BLOCK + 4;
+    w->blocks = (double **)allocateOrDie(w->maxBlocks*sizeof(double *));
+    for (int b = 0; b < w->maxBlocks; ++b) {
+        w->blocks[b] = (double *)allocateOrDie(SORTED_BLOCK*sizeof(double));
+    }//for
+    w->lasts = (double *)allocateOrDie(w->maxBlocks*sizeof(double));
+    w->sizes = (int *)allocateOrDie(w->maxBlocks*sizeof(int));
+    w->tree = (int *)allocateOrDie((w->maxBlocks+1)*sizeof(int));
+
+    w->step = 1;
+    while (2*w->step <= w->maxBlocks) {
+        w->step *= 2;
+    }//wend
+
+    // a single empty block keeps every search well defined
+    w->nblocks = 1;
+    w->sizes[0] = 0;
+    w->size = 0;
+    rebuildBlockIndex(*w);
+}
+
+
+void destroySortedWindow(SortedWindow *w) {
+
+    if (w && w->blocks) {
+        for (int b = 0; b < w->maxBlocks; ++b) {
+            free(w->blocks[b]);
+        }//for
+        free(w->blocks);
+        free(w->lasts);
+        free(w->sizes);
+        free(w->tree);
+        w->blocks = NULL;
+    }//fi
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Updates
+
+// Blocks keep their buffers: inserting or removing one only rotates the pointers
+static void splitBlock(SortedWindow& w, int b) {
+
+    if (w.nblocks == w.maxBlocks) {
+        std::cerr << "ERROR: sorted window out of blocks" << std::endl;
+        exit(1);
+    }
+
+    double *spare = w.blocks[w.nblocks];
+    memmove(&w.blocks[b+2], &w.blocks[b+1], (w.nblocks - b - 1)*sizeof(double *));
+    memmove(&w.lasts[b+2], &w.lasts[b+1], (w.nblocks - b - 1)*sizeof(double));
+    memmove(&w.sizes[b+2], &w.sizes[b+1], (w.nblocks - b - 1)*sizeof(int));
+    w.blocks[b+1] = spare;
+    ++w.nblocks;
+
+    int half = w.sizes[b]/2;
+    int rest = w.sizes[b] - half;
+    memcpy(w.blocks[b+1], &w.blocks[b][half], rest*sizeof(double));
+    w.sizes[b] = half;
+    w.sizes[b+1] = rest;
+    w.lasts[b+1] = w.lasts[b];
+    w.lasts[b] = w.blocks[b][half-1];
+
+    rebuildBlockIndex(w);
+}
+
+
+// Appends block b+1 to block b
+static void mergeBlocks(SortedWindow& w, int b) {
+
+    memcpy(&w.blocks[b][w.sizes[b]], w.blocks[b+1], w.sizes[b+1]*sizeof(double));
+    if (w.sizes[b+1]) {
+        w.lasts[b] = w.lasts[b+1];
+    }
+    w.sizes[b] += w.sizes[b+1];
+
+    double *spare = w.blocks[b+1];
+    memmove(&w.blocks[b+1], &w.blocks[b+2], (w.nblocks - b - 2)*sizeof(double *));
+    memmove(&w.lasts[b+1], &w.lasts[b+2], (w.nblocks - b - 2)*sizeof(double));
+    memmove(&w.sizes[b+1], &w.sizes[b+2], (w.nblocks - b - 2)*sizeof(int));
+    --w.nblocks;
+    w.blocks[w.nblocks] = spare;
+
+    rebuildBlockIndex(w);
+}
+
+
+void insertSorted(SortedWindow& w, double value) {
+
+    int b = findBlock(w, value);
+    if (w.sizes[b] == SORTED_BLOCK) {
+        splitBlock(w, b);
+        b = findBlock(w, value);
+    }
+
+    double *block = w.blocks[b];
+    int n = w.sizes[b];
+    int i = std::upper_bound(block, block + n, value) - block;
+    memmove(&block[i+1], &block[i], (n - i)*sizeof(double));
+    block[i] = value;
+
+    ++w.sizes[b];
+    w.lasts[b] = block[n];
+    addToBlockIndex(w, b, 1);
+    ++w.size;
+}
+
+
+void eraseSorted(SortedWindow& w, double value) {
+
+    int b = findBlock(w, value);
+    double *block = w.blocks[b];
+    int n = w.sizes[b];
+    int i = std::lower_bound(block, block + n, value) - block;
+    if (i == n || block[i] != value) {
+        std::cerr << "ERROR: value " << value << " not in the sorted window" << std::endl;
+        exit(1);
+    }
+
+    memmove(&block[i], &block[i+1], (n - i - 1)*sizeof(double));
+    --w.sizes[b];
+    --w.size;
+
+    if (w.sizes[b] > 0) {
+        w.lasts[b] = block[n-2];
+        addToBlockIndex(w, b, -1);
+    } else if (w.nblocks > 1) {
+        mergeBlocks(w, (b > 0) ? b-1 : b);      // drops the empty block
+        return;
+    } else {
+        addToBlockIndex(w, b, -1);
+        return;
+    }
+
+    if (b+1 < w.nblocks && w.sizes[b] + w.sizes[b+1] <= SORTED_BLOCK/2) {
+        mergeBlocks(w, b);
+    } else if (b > 0 && w.sizes[b-1] + w.sizes[b] <= SORTED_BLOCK/2) {
+        mergeBlocks(w, b-1);
+    }
+}
+
+
+int rankOfSorted(SortedWindow& w, double value) {
+
+    int b = findBlock(w, value);
+
+    int rank = 0;
+    for (int i = b; i > 0; i -= i & (-i)) {
+        rank += w.tree[i];
+    }//for
+
+    double *block = w.blocks[b];
+    return rank + (std::lower_bound(block, block + w.sizes[b], value) - block);
+}
@@ -0,0 +1,80 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __SORTEDWINDOW_H__
+#define __SORTEDWINDOW_H__
+
+const int SORTED_BLOCK = 512;      // values per block at most; a full block splits in two
+
+
+// Sorted window for large s: a list of sorted blocks of at most SORTED_BLOCK values
+// with a Fenwick tree over the block sizes. Insert and delete move at most one block
+// of values plus O(log #blocks) tree nodes, where the flat sorted array moves O(s);
+// the value of rank j is found by descending the tree.
+// Two adjacent blocks that fit in half a block are merged, so #blocks <= 4s/SORTED_BLOCK + 2.
+typedef struct SortedWindow {
+    double **blocks;
+    double *lasts;          // largest value of each block, searched to locate a value
+    int *sizes;
+    int *tree;              // 1-based Fenwick tree over sizes
+    int nblocks;
+    int maxBlocks;
+    int step;               // highest power of two not greater than maxBlocks
+
+    int cacheBlock;         // block of the last sortedAt(), and rank of its first value:
+    int cacheStart;         // runs of lookups mostly stay in one block
+
+    int size;
+} SortedWindow;
+
+
+
+void initSortedWindow(SortedWindow *w, int s);
+
+void destroySortedWindow(SortedWindow *w);
+
+void insertSorted(SortedWindow& w, double value);
+
+void eraseSorted(SortedWindow& w, double value);
+
+// Rank of the first value not less than value
+int rankOfSorted(SortedWindow& w, double value);
+
+
+inline double sortedAt(SortedWindow& w, int rank) {
+
+    int r = rank - w.cacheStart;
+    if ((unsigned)r < (unsigned)w.sizes[w.cacheBlock]) {
+        return w.blocks[w.cacheBlock][r];
+    }
+
+    int b = 0;
+    r = rank;
+    for (int step = w.step; step > 0; step >>= 1) {
+        if (b + step <= w.nblocks && w.tree[b + step] <= r) {
+            b += step;
+            r -= w.tree[b];
+        }
+    }//for
+
+    w.cacheBlock = b;
+    w.cacheStart = rank - r;
+    return w.blocks[b][r];
+}
+
+
+#endif //__SORTEDWINDOW_H__
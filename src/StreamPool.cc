@@ -0,0 +1,316 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "StreamPool.h"
+
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Threads
+
+static void pinThread(int t) {
+
+    #ifdef __linux__
+        int cores = std::thread::hardware_concurrency();
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(t % (cores > 0 ? cores : 1), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+    #endif
+}
+
+
+// Number of shards thread t owns
+static inline int ownedShards(StreamPool *pool, int t) {
+    return (pool->shards - t + pool->threads - 1)/pool->threads;
+}
+
+
+// Slice of the batch thread t counts and scatters
+static inline void getSlice(StreamPool *pool, int t, long *from, long *to) {
+
+    long n = pool->last - pool->first;
+    *from = pool->first + n*t/pool->threads;
+    *to = pool->first + n*(t+1)/pool->threads;
+}
+
+
+static void setupShards(StreamPool *pool, int t, int s, int sketchBound, double alpha, int capacity) {
+
+    for (int h = t; h < pool->shards; h += pool->threads) {
+        int streams = (pool->streams - h + pool->shards - 1)/pool->shards;
+        StreamSet& set = pool->sets[h];
+        if (initStreamSet(&set, streams, s, sketchBound, alpha, capacity, pool->batchCapacity)) {
+            pool->status = 1;
+            set.streams = 0;
+            continue;
+        }
+        // first touch of the windows too, the sketch slots already are
+        memset(set.windows, 0, (size_t)streams*set.stride*sizeof(Value));
+        memset(set.sorted, 0, (size_t)streams*set.stride*sizeof(Value));
+    }//for owned shards
+}
+
+
+static void countSlice(StreamPool *pool, int t) {
+
+    long from, to;
+    getSlice(pool, t, &from, &to);
+    long *histogram = pool->histograms + (size_t)t*pool->shards;
+    memset(histogram, 0, pool->shards*sizeof(long));
+    for (long i = from; i < to; ++i) {
+        ++histogram[pool->ids[i] % pool->shards];
+    }//for
+}
+
+
+static void scatterSlice(StreamPool *pool, int t) {
+
+    long from, to;
+    getSlice(pool, t, &from, &to);
+    long *next = pool->histograms + (size_t)t*pool->shards;
+    for (long i = from; i < to; ++i) {
+        int id = pool->ids[i];
+        long k = next[id % pool->shards]++;
+        pool->order[k] = i;
+        pool->localIds[k] = id / pool->shards;
+        pool->localItems[k] = pool->items[i];
+    }//for
+}
+
+
+static long updateShard(StreamPool *pool, int h) {
+
+    long from = pool->shardStarts[h];
+    long to = pool->shardStarts[h+1];
+    if (from == to) {
+        return 0;
+    }
+
+    long estimates = pushStreamBatch(&pool->sets[h], pool->localIds + from, pool->localItems + from, to - from, pool->localResults + from);
+    for (long k = from; k < to; ++k) {
+        pool->results[pool->order[k]] = pool->localResults[k];
+    }//for
+    return estimates;
+}
+
+
+// Own shards first, then those the other threads have not claimed yet
+static void updateShards(StreamPool *pool, int t) {
+
+    long estimates = 0;
+    for (int i = 0; i < pool->threads; ++i) {
+        int victim = (t + i) % pool->threads;
+        int owned = ownedShards(pool, victim);
+        int k;
+        while ((k = pool->claims[victim].next.fetch_add(1, std::memory_order_relaxed)) < owned) {
+            estimates += updateShard(pool, victim + k*pool->threads);
+        }//wend
+    }//for victims
+    pool->claims[t].estimates = estimates;
+}
+
+
+static void destroyShards(StreamPool *pool, int t) {
+
+    for (int h = t; h < pool->shards; h += pool->threads) {
+        if (pool->sets[h].streams > 0) {
+            destroyStreamSet(&pool->sets[h]);
+        }
+    }//for owned shards
+}
+
+
+static void runWorker(StreamPool *pool, int t, int s, int sketchBound, double alpha, int capacity) {
+
+    pinThread(t);
+
+    long seen = 0;
+    for (;;) {
+        PoolPhase phase;
+        {
+            std::unique_lock<std::mutex> guard(pool->lock);
+            pool->wake.wait(guard, [&]{ return pool->generation != seen; });
+            seen = pool->generation;
+            phase = pool->phase;
+        }
+
+        switch (phase) {
+            case POOL_INIT:
+                setupShards(pool, t, s, sketchBound, alpha, capacity);
+                break;
+            case POOL_COUNT:
+                countSlice(pool, t);
+                break;
+            case POOL_SCATTER:
+                scatterSlice(pool, t);
+                break;
+            case POOL_UPDATE:
+                updateShards(pool, t);
+                break;
+            case POOL_DESTROY:
+                destroyShards(pool, t);
+                break;
+            case POOL_EXIT:
+                break;
+        }//switch
+
+        {
+            std::lock_guard<std::mutex> guard(pool->lock);
+            if (!--pool->pending) {
+                pool->done.notify_one();
+            }
+        }
+        if (phase == POOL_EXIT) {
+            return;
+        }
+    }//for phases
+}
+
+
+// Runs phase on every thread and waits for all of them
+static void runPhase(StreamPool *pool, PoolPhase phase) {
+
+    std::unique_lock<std::mutex> guard(pool->lock);
+    pool->phase = phase;
+    pool->pending = pool->threads;
+    ++pool->generation;
+    pool->wake.notify_all();
+    pool->done.wait(guard, [&]{ return pool->pending == 0; });
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Set up
+
+int initStreamPool(StreamPool *pool, int threads, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity) {
+
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    if (streams < 1 || s < 3 || sketchBound < 1 || alpha < MIN_ALPHA || alpha >= 1.0 || capacity < 2 || batchCapacity < 1) {
+        return 1;
+    }
+
+    pool->threads = std::min(threads, streams);
+    pool->shards = std::min(pool->threads*POOL_SHARDS_PER_THREAD, streams);
+    pool->streams = streams;
+    pool->batchCapacity = batchCapacity;
+    pool->status = 0;
+
+    pool->sets = (StreamSet *)allocateAligned(pool->shards*sizeof(StreamSet));
+    pool->claims = (PoolClaim *)allocateAligned(pool->threads*sizeof(PoolClaim));
+    for (int t = 0; t < pool->threads; ++t) {
+        new (&pool->claims[t]) PoolClaim();
+    }//for
+    pool->histograms = (long *)allocateAligned((size_t)pool->threads*pool->shards*sizeof(long));
+    pool->shardStarts = (long *)allocateAligned((pool->shards+1)*sizeof(long));
+    pool->order = (long *)allocateAligned(batchCapacity*sizeof(long));
+    pool->localIds = (int *)allocateAligned(batchCapacity*sizeof(int));
+    pool->localItems = (Value *)allocateAligned(batchCapacity*sizeof(Value));
+    pool->localResults = (Item *)allocateAligned(batchCapacity*sizeof(Item));
+
+    pool->generation = 0;
+    pool->pending = 0;
+
+    pool->workers = new std::thread[pool->threads];
+    for (int t = 0; t < pool->threads; ++t) {
+        pool->workers[t] = std::thread(runWorker, pool, t, s, sketchBound, alpha, capacity);
+    }//for
+
+    runPhase(pool, POOL_INIT);
+    if (pool->status) {
+        destroyStreamPool(pool);
+        return 1;
+    }
+    return 0;
+}
+
+
+void destroyStreamPool(StreamPool *pool) {
+
+    runPhase(pool, POOL_DESTROY);
+    runPhase(pool, POOL_EXIT);
+    for (int t = 0; t < pool->threads; ++t) {
+        pool->workers[t].join();
+    }//for
+    delete [] pool->workers;
+
+    free(pool->sets);
+    free(pool->claims);
+    free(pool->histograms);
+    free(pool->shardStarts);
+    free(pool->order);
+    free(pool->localIds);
+    free(pool->localItems);
+    free(pool->localResults);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Updates
+
+long pushPoolBatch(StreamPool *pool, const int *ids, const Value *items, long n, Item *results) {
+
+    for (long i = 0; i < n; ++i) {
+        if (ids[i] < 0 || ids[i] >= pool->streams) {
+            return -1;
+        }
+    }//for
+
+    pool->ids = ids;
+    pool->items = items;
+    pool->results = results;
+
+    long estimates = 0;
+    for (pool->first = 0; pool->first < n; pool->first += pool->batchCapacity) {
+
+        pool->last = std::min(n, pool->first + pool->batchCapacity);
+        runPhase(pool, POOL_COUNT);
+
+        // the slices in order within every shard, so each stream keeps the order of the batch
+        long k = 0;
+        for (int h = 0; h < pool->shards; ++h) {
+            pool->shardStarts[h] = k;
+            for (int t = 0; t < pool->threads; ++t) {
+                long *count = pool->histograms + (size_t)t*pool->shards + h;
+                long slice = *count;
+                *count = k;
+                k += slice;
+            }//for threads
+        }//for shards
+        pool->shardStarts[pool->shards] = k;
+
+        runPhase(pool, POOL_SCATTER);
+
+        for (int t = 0; t < pool->threads; ++t) {
+            pool->claims[t].next.store(0, std::memory_order_relaxed);
+        }//for
+        runPhase(pool, POOL_UPDATE);
+        for (int t = 0; t < pool->threads; ++t) {
+            estimates += pool->claims[t].estimates;
+        }//for
+    }//for batches
+
+    return estimates;
+}
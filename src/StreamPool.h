@@ -0,0 +1,102 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __STREAMPOOL_H__
+#define __STREAMPOOL_H__
+
+#include "StreamSet.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+const int POOL_SHARDS_PER_THREAD = 8;       // shards a thread owns, the unit of stealing
+
+
+typedef enum PoolPhase {
+    POOL_INIT = 0,          // every thread sets up the shards it owns
+    POOL_COUNT = 1,         // updates of a slice of the batch counted by shard
+    POOL_SCATTER = 2,       // and copied to their shard's run of the batch
+    POOL_UPDATE = 3,        // shards claimed and pushed, own ones first, then stolen
+    POOL_DESTROY = 4,
+    POOL_EXIT = 5
+} PoolPhase;
+
+
+// Next shard to claim among those a thread owns, alone in its cache line
+typedef struct PoolClaim {
+    std::atomic<int> next;
+    long estimates;         // written by the owner thread only
+    char pad[MEMORY_ALIGNMENT - sizeof(std::atomic<int>) - sizeof(long)];
+} PoolClaim;
+
+
+// Streams sharded over a pool of threads: shard h is a StreamSet with the streams id such
+// that id % shards == h, as id / shards, and thread t owns the shards h % threads == t. A
+// thread is pinned to a core and allocates its shards there, so that their windows and
+// sketches are on its NUMA node (first touch). A batch of updates is split by shard and
+// every shard's run is pushed whole by the one thread that claims it: the owner, or a thief
+// once the owner has run out of work. The streams keep their order and the update path
+// takes no lock; the threads only meet between the phases of a batch.
+typedef struct StreamPool {
+    int threads;
+    int shards;
+    int streams;
+    long batchCapacity;
+
+    StreamSet *sets;
+    std::thread *workers;
+    PoolClaim *claims;
+    int status;                 // 1 if a shard could not be set up
+
+    long *histograms;           // threads x shards: updates of every slice by shard, then where they go
+    long *shardStarts;          // first update of every shard in the split batch, shards+1 of them
+    long *order;                // index in the batch of every update of the split batch
+    int *localIds;
+    Value *localItems;
+    Item *localResults;
+
+    // batch being processed
+    const int *ids;
+    const Value *items;
+    Item *results;
+    long first;
+    long last;
+
+    PoolPhase phase;
+    long generation;
+    int pending;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+} StreamPool;
+
+
+
+// threads <= 0 takes one per hardware thread. Returns 0, or 1 on an invalid configuration
+// (as for initStreamSet) or if the shards cannot be set up
+int initStreamPool(StreamPool *pool, int threads, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity);
+
+void destroyStreamPool(StreamPool *pool);
+
+// As pushStreamBatch(), spread over the threads: results[i] answers update i (seq 0 during
+// the warm-up of its stream). Returns the number of estimates, or -1 if an id is out of range.
+long pushPoolBatch(StreamPool *pool, const int *ids, const Value *items, long n, Item *results);
+
+
+#endif //__STREAMPOOL_H__
@@ -0,0 +1,237 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "StreamRouter.h"
+
+#include <cstring>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Keys
+
+// FNV-1a
+static inline uint64_t hashKey(const char *key, int length) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < length; ++i) {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }//for
+    return hash;
+}
+
+
+// Table position holding slot, or the empty one where key would go
+static inline int probeKey(StreamRouter *router, const char *key, int length, uint64_t hash) {
+
+    int i = hash & router->tableMask;
+    for (;;) {
+        int slot = router->table[i];
+        if (slot == -1) {
+            return i;
+        }
+        RouterKey& entry = router->keys[slot];
+        if (entry.hash == hash && entry.length == length && !memcmp(entry.name, key, length)) {
+            return i;
+        }
+        i = (i + 1) & router->tableMask;
+    }//for
+}
+
+
+// Empties table position i, moving back the entries of the run after it (no tombstones)
+static void removeFromTable(StreamRouter *router, int i) {
+
+    int j = i;
+    for (;;) {
+        j = (j + 1) & router->tableMask;
+        int slot = router->table[j];
+        if (slot == -1) {
+            break;
+        }
+        int home = router->keys[slot].hash & router->tableMask;
+        // the entry at j may fill the hole at i unless its home lies in (i, j]
+        bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            router->table[i] = slot;
+            i = j;
+        }
+    }//for
+    router->table[i] = -1;
+}
+
+
+static inline void unlinkKey(StreamRouter *router, int slot) {
+
+    RouterKey& entry = router->keys[slot];
+    if (entry.older != -1) router->keys[entry.older].newer = entry.newer; else router->oldest = entry.newer;
+    if (entry.newer != -1) router->keys[entry.newer].older = entry.older; else router->newest = entry.older;
+}
+
+
+static inline void linkNewest(StreamRouter *router, int slot) {
+
+    RouterKey& entry = router->keys[slot];
+    entry.older = router->newest;
+    entry.newer = -1;
+    if (router->newest != -1) router->keys[router->newest].newer = slot; else router->oldest = slot;
+    router->newest = slot;
+}
+
+
+static void evictKey(StreamRouter *router, int slot) {
+
+    RouterKey& entry = router->keys[slot];
+    removeFromTable(router, probeKey(router, entry.name, entry.length, entry.hash));
+    unlinkKey(router, slot);
+    resetStream(&router->set, slot);
+
+    router->bytes -= entry.bytes;
+    free(entry.name);
+    entry.name = NULL;
+    router->freeSlots[router->freeCount++] = slot;
+    --router->liveKeys;
+}
+
+
+static int createKey(StreamRouter *router, int position, const char *key, int length, uint64_t hash) {
+
+    if (!router->freeCount) {
+        evictKey(router, router->oldest);
+        ++router->forcedEvictions;
+        position = probeKey(router, key, length, hash);
+    }
+
+    int slot = router->freeSlots[--router->freeCount];
+    RouterKey& entry = router->keys[slot];
+    entry.name = (char *)malloc(length + 1);
+    memcpy(entry.name, key, length);
+    entry.name[length] = '\0';
+    entry.length = length;
+    entry.hash = hash;
+    entry.bytes = getStreamBytes(&router->set) + sizeof(RouterKey) + 2*sizeof(int) + length + 1;
+
+    router->table[position] = slot;
+    linkNewest(router, slot);
+    ++router->liveKeys;
+    ++router->created;
+    router->bytes += entry.bytes;
+    router->peakBytes = std::max(router->peakBytes, router->bytes);
+    return slot;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Set up
+
+int initStreamRouter(StreamRouter *router, int maxKeys, double idleTimeout, int s, int sketchBound, double alpha, int capacity) {
+
+    if (maxKeys < 1 || initStreamSet(&router->set, maxKeys, s, sketchBound, alpha, capacity, 1)) {
+        return 1;
+    }
+
+    int tableSize = 1;
+    while (tableSize < 2*maxKeys) {
+        tableSize *= 2;
+    }//wend
+
+    router->keys = (RouterKey *)allocateAligned(maxKeys*sizeof(RouterKey));
+    router->table = (int *)allocateAligned(tableSize*sizeof(int));
+    router->freeSlots = (int *)allocateAligned(maxKeys*sizeof(int));
+    router->tableMask = tableSize - 1;
+    for (int i = 0; i < tableSize; ++i) {
+        router->table[i] = -1;
+    }//for
+    for (int i = 0; i < maxKeys; ++i) {
+        router->keys[i].name = NULL;
+        router->freeSlots[i] = maxKeys - 1 - i;
+    }//for
+    router->freeCount = maxKeys;
+    router->oldest = -1;
+    router->newest = -1;
+
+    router->maxKeys = maxKeys;
+    router->idleTimeout = idleTimeout;
+    router->liveKeys = 0;
+    router->created = 0;
+    router->idleEvictions = 0;
+    router->forcedEvictions = 0;
+    router->bytes = 0;
+    router->peakBytes = 0;
+    return 0;
+}
+
+
+void destroyStreamRouter(StreamRouter *router) {
+
+    for (int i = 0; i < router->maxKeys; ++i) {
+        free(router->keys[i].name);
+    }//for
+    free(router->keys);
+    free(router->table);
+    free(router->freeSlots);
+    destroyStreamSet(&router->set);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Records
+
+int evictIdleKeys(StreamRouter *router, double now) {
+
+    if (router->idleTimeout <= 0) {
+        return 0;
+    }
+
+    int evicted = 0;
+    while (router->oldest != -1 && router->keys[router->oldest].lastSeen < now - router->idleTimeout) {
+        evictKey(router, router->oldest);
+        ++evicted;
+    }//wend
+    router->idleEvictions += evicted;
+    return evicted;
+}
+
+
+int routeItem(StreamRouter *router, const char *key, int length, double timestamp, Value item, Item *result) {
+
+    evictIdleKeys(router, timestamp);
+
+    uint64_t hash = hashKey(key, length);
+    int position = probeKey(router, key, length, hash);
+    int slot = router->table[position];
+    if (slot == -1) {
+        slot = createKey(router, position, key, length, hash);
+    } else if (slot != router->newest) {
+        unlinkKey(router, slot);
+        linkNewest(router, slot);
+    }
+
+    router->keys[slot].lastSeen = timestamp;
+    return pushStream(&router->set, slot, item, result);
+}
+
+
+int findKey(StreamRouter *router, const char *key, int length) {
+    return router->table[probeKey(router, key, length, hashKey(key, length))];
+}
+
+
+size_t getKeyBytes(StreamRouter *router, const char *key, int length) {
+
+    int slot = findKey(router, key, length);
+    return (slot == -1) ? 0 : router->keys[slot].bytes;
+}
@@ -0,0 +1,86 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __STREAMROUTER_H__
+#define __STREAMROUTER_H__
+
+#include "StreamSet.h"
+
+#include <stdint.h>
+
+
+// A live key: the stream slot of the same index serves it
+typedef struct RouterKey {
+    char *name;
+    int length;
+    uint64_t hash;
+    double lastSeen;        // timestamp of its last record
+    int older;              // neighbours in the recency list, -1 at its ends
+    int newer;
+    size_t bytes;           // memory accounted to the key: slot, entry and name
+} RouterKey;
+
+
+// Keyed streams on a fixed pool of StreamSet slots: a key gets a slot at its first record
+// and gives it back when evicted, either after idleTimeout (in timestamp units) without
+// records or, with all the slots taken, as the least recently seen key. The memory is
+// that of maxKeys slots whatever the churn of the keys.
+typedef struct StreamRouter {
+    StreamSet set;
+    RouterKey *keys;
+    int *table;             // slots by hash, linear probing, -1 empty
+    int tableMask;
+    int *freeSlots;
+    int freeCount;
+    int oldest;             // recency list of the live keys
+    int newest;
+
+    int maxKeys;
+    double idleTimeout;     // <= 0 keys are only evicted to make room
+
+    int liveKeys;
+    long created;
+    long idleEvictions;
+    long forcedEvictions;
+    size_t bytes;           // accounted to the live keys
+    size_t peakBytes;
+} StreamRouter;
+
+
+
+// Slots of capacity buckets for s, sketchBound and alpha as in initStreamSet(). Returns 0,
+// or 1 on an invalid configuration.
+int initStreamRouter(StreamRouter *router, int maxKeys, double idleTimeout, int s, int sketchBound, double alpha, int capacity);
+
+void destroyStreamRouter(StreamRouter *router);
+
+// Pushes item, seen at timestamp, to the stream of key (length bytes), creating it if it
+// is not live. Returns 1 and the result for the middle item of its window, or 0 while the
+// window fills.
+int routeItem(StreamRouter *router, const char *key, int length, double timestamp, Value item, Item *result);
+
+// Evicts the keys without records after now - idleTimeout; returns how many
+int evictIdleKeys(StreamRouter *router, double now);
+
+// Slot of a live key, or -1
+int findKey(StreamRouter *router, const char *key, int length);
+
+// Memory accounted to a live key, 0 if it is not live
+size_t getKeyBytes(StreamRouter *router, const char *key, int length);
+
+
+#endif //__STREAMROUTER_H__
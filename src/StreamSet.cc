@@ -0,0 +1,513 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "StreamSet.h"
+#include "FixedWindow.h"
+
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Set up
+
+
+
+static inline Value *getStreamWindow(StreamSet *set, int id) {
+    return set->windows + (size_t)id*set->stride;
+}
+
+
+static inline Value *getStreamSorted(StreamSet *set, int id) {
+    return set->sorted + (size_t)id*set->stride;
+}
+
+
+// Empty sketch centred in its slot, whose buckets are already zero, and no item yet
+static void clearStreamState(StreamState& state) {
+
+    int capacity = state.sketch.capacity;
+    state.sketch.offset = -capacity/2;
+    state.sketch.lo = capacity;
+    state.sketch.hi = -1;
+    state.sketch.zeroCount = 0;
+    state.sketch.bins = 0;
+    state.sketch.cursor = -1;
+    state.sketch.below = 0;
+    state.count = 0;
+    state.pos = -1;
+    state.collapses = 0;
+}
+
+
+// State of stream id with its sketch on its bucket slot: the pointer is not kept from one
+// call to the next, so that the states hold no address (see openStreamSet()). A state of
+// zeros, as in a new store file, is that of a stream without items.
+static inline StreamState& getStreamState(StreamSet *set, int id) {
+
+    StreamState& state = set->states[(size_t)id*set->stateStride];
+    state.sketch.counts = set->counts + (size_t)id*set->countStride;
+    if (!state.sketch.capacity) {
+        state.sketch.capacity = set->capacity;
+        clearStreamState(state);
+    }
+    return state;
+}
+
+
+// Everything but the four blocks of the streams
+static int configureStreamSet(StreamSet *set, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity) {
+
+    if (streams < 1 || s < 3 || sketchBound < 1 || alpha < MIN_ALPHA || alpha >= 1.0 || capacity < 2 || batchCapacity < 1) {
+        return 1;
+    }
+
+    int lineItems = MEMORY_ALIGNMENT/sizeof(Value);
+    int windowItems = windowCapacity(s);
+
+    set->streams = streams;
+    set->s = s;
+    set->sketchBound = sketchBound;
+    set->capacity = capacity;
+    set->stride = (windowItems + lineItems - 1)/lineItems*lineItems;
+    set->stateStride = 1;
+    set->countStride = capacity;
+    set->streamBytes = sizeof(StreamState) + 2*set->stride*sizeof(Value) + capacity*sizeof(BinCount);
+    set->windows = NULL;
+    set->sorted = NULL;
+    set->counts = NULL;
+    set->states = NULL;
+    set->mapping = NULL;
+    set->mappedBytes = 0;
+
+    set->alphaAt[0] = alpha;
+    for (int l = 0; l < STREAM_MAX_LEVELS; ++l) {
+        if (l > 0) {
+            set->alphaAt[l] = getCurrentAlpha(set->alphaAt[l-1]);
+        }
+        set->gammaAt[l] = getCurrentGamma(set->alphaAt[l]);
+        set->logGAt[l] = getCurrentLogG(set->gammaAt[l]);
+    }//for levels
+
+    int h = s/2 + 1;
+    set->kth = (long)h*(h-1)/2;
+    set->I = (long)s*(s-1)/2;
+    set->quantile = getQuantileFraction(set->kth, set->I);
+    set->QnScale = getQnScaleFactor(s, QFactor);
+
+    set->batchCapacity = batchCapacity;
+    set->order = (long *)allocateAligned(batchCapacity*sizeof(long));
+    set->starts = (long *)allocateAligned((streams+1)*sizeof(long));
+    set->keys = (int *)allocateAligned(s*sizeof(int));
+    return 0;
+}
+
+
+int initStreamSet(StreamSet *set, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity) {
+
+    if (configureStreamSet(set, streams, s, sketchBound, alpha, capacity, batchCapacity)) {
+        return 1;
+    }
+
+    set->windows = (Value *)allocateAligned((size_t)streams*set->stride*sizeof(Value));
+    set->sorted = (Value *)allocateAligned((size_t)streams*set->stride*sizeof(Value));
+    set->counts = (BinCount *)allocateAligned((size_t)streams*capacity*sizeof(BinCount));
+    set->states = (StreamState *)allocateAligned((size_t)streams*sizeof(StreamState));
+    memset(set->counts, 0, (size_t)streams*capacity*sizeof(BinCount));
+    memset(set->states, 0, (size_t)streams*sizeof(StreamState));
+    return 0;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** File store
+
+const char STORE_MAGIC[8] = "AFQNSET";
+const int STORE_VERSION = 1;
+const size_t STORE_PAGE = 4096;
+
+// First page of a store file. The streams follow as records of recordBytes, each its state,
+// window, sorted window and sketch buckets: a cold stream is paged in by a page or two.
+typedef struct StoreHeader {
+    char magic[8];
+    int version;
+    int valueBytes;
+    int streams;
+    int s;
+    int sketchBound;
+    int capacity;
+    int stride;
+    double alpha;
+    size_t recordsAt;
+    size_t recordBytes;
+    size_t bytes;
+} StoreHeader;
+
+
+static void getStoreLayout(StreamSet *set, double alpha, StoreHeader *header) {
+
+    memset(header, 0, sizeof(StoreHeader));
+    memcpy(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header->version = STORE_VERSION;
+    header->valueBytes = sizeof(Value);
+    header->streams = set->streams;
+    header->s = set->s;
+    header->sketchBound = set->sketchBound;
+    header->capacity = set->capacity;
+    header->stride = set->stride;
+    header->alpha = alpha;
+
+    // a multiple of the state, of the items and of the buckets alike
+    header->recordsAt = STORE_PAGE;
+    header->recordBytes = (set->streamBytes + MEMORY_ALIGNMENT - 1)/MEMORY_ALIGNMENT*MEMORY_ALIGNMENT;
+    header->bytes = header->recordsAt + (size_t)set->streams*header->recordBytes;
+}
+
+
+int openStreamSet(StreamSet *set, const char *path, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity) {
+
+    if (configureStreamSet(set, streams, s, sketchBound, alpha, capacity, batchCapacity)) {
+        return 1;
+    }
+
+    StoreHeader layout;
+    getStoreLayout(set, alpha, &layout);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        std::cerr << "ERROR: unable to open the stream store " << path << std::endl;
+        if (fd != -1) close(fd);
+        destroyStreamSet(set);
+        return 1;
+    }
+
+    bool created = (info.st_size == 0);
+    if (created && ftruncate(fd, layout.bytes) == -1) {
+        std::cerr << "ERROR: unable to size the stream store " << path << std::endl;
+        close(fd);
+        destroyStreamSet(set);
+        return 1;
+    }
+    if (!created && (size_t)info.st_size != layout.bytes) {
+        std::cerr << "ERROR: the stream store " << path << " holds another configuration" << std::endl;
+        close(fd);
+        destroyStreamSet(set);
+        return 1;
+    }
+
+    void *mapping = mmap(NULL, layout.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "ERROR: unable to map the stream store " << path << std::endl;
+        destroyStreamSet(set);
+        return 1;
+    }
+
+    StoreHeader *header = (StoreHeader *)mapping;
+    if (!created && memcmp(header, &layout, sizeof(StoreHeader))) {
+        std::cerr << "ERROR: the stream store " << path << " holds another configuration" << std::endl;
+        munmap(mapping, layout.bytes);
+        destroyStreamSet(set);
+        return 1;
+    }
+
+    char *record = (char *)mapping + layout.recordsAt;
+    size_t windowBytes = set->stride*sizeof(Value);
+    set->mapping = mapping;
+    set->mappedBytes = layout.bytes;
+    set->states = (StreamState *)record;
+    set->windows = (Value *)(record + sizeof(StreamState));
+    set->sorted = (Value *)(record + sizeof(StreamState) + windowBytes);
+    set->counts = (BinCount *)(record + sizeof(StreamState) + 2*windowBytes);
+    set->stateStride = layout.recordBytes/sizeof(StreamState);
+    set->stride = layout.recordBytes/sizeof(Value);
+    set->countStride = layout.recordBytes/sizeof(BinCount);
+    set->streamBytes = layout.recordBytes;
+
+    if (created) {
+        // the records start as zeros, streams without items, and take no disk nor memory until written
+        memcpy(header, &layout, sizeof(StoreHeader));
+    }
+    return 0;
+}
+
+
+int syncStreamSet(StreamSet *set) {
+    return set->mapping != NULL && msync(set->mapping, set->mappedBytes, MS_SYNC) == -1;
+}
+
+
+void destroyStreamSet(StreamSet *set) {
+
+    if (set->mapping != NULL) {
+        munmap(set->mapping, set->mappedBytes);
+        set->mapping = NULL;
+    } else {
+        free(set->windows);
+        free(set->sorted);
+        free(set->counts);
+        free(set->states);
+    }
+    free(set->order);
+    free(set->starts);
+    free(set->keys);
+}
+
+
+
+void resetStream(StreamSet *set, int id) {
+
+    DenseSketch& sketch = getStreamState(set, id).sketch;
+    if (sketch.lo <= sketch.hi) {
+        memset(sketch.counts + sketch.lo, 0, (sketch.hi - sketch.lo + 1)*sizeof(BinCount));
+    }
+    clearStreamState(getStreamState(set, id));
+}
+
+
+size_t getStreamBytes(StreamSet *set) {
+    return set->streamBytes;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Per-stream steps
+
+// Key of |a - b|, the difference taken in Value (exactly for ints), as the engine does
+template <class T>
+static inline int streamDiffKey(T a, T b, DenseSketch& sketch, double gamma, double logG) {
+    return getSketchKey(sketch, std::abs(a - b), gamma, logG);
+}
+
+static inline int streamDiffKey(int a, int b, DenseSketch& sketch, double gamma, double logG) {
+    return getIntSketchKey(sketch, intDiff(a, b), gamma, logG);
+}
+
+
+static inline void collapseStream(StreamState& state) {
+
+    collapseUniformly(state.sketch);
+    if (state.collapses < STREAM_MAX_LEVELS-1) {
+        ++state.collapses;
+    }
+}
+
+
+// Recentres the sketch slot so that the keys in [minKey, maxKey] fit it; 0 if they cannot without a collapse
+static inline int fitStreamKeys(StreamState& state, int minKey, int maxKey) {
+
+    return (minKey > maxKey) || fitDenseSketch(state.sketch, minKey, maxKey);
+}
+
+
+// Items of the sorted window whose differences from new_item have the extreme keys: its
+// neighbours and the two ends, among the s-1 items that stay (one instance of old_item
+// is skipped); equal items have null differences and are left out. Returns their number.
+template <class T>
+static int getStreamNeighbours(const T *sorted, int s, T new_item, T old_item, T *candidates) {
+
+    bool skipped = false;
+    int below = std::lower_bound(sorted, sorted + s, new_item) - sorted - 1;
+    int above = std::upper_bound(sorted, sorted + s, new_item) - sorted;
+    for (; below >= 0 && !skipped && sorted[below] == old_item; --below) skipped = true;
+    for (; above < s && !skipped && sorted[above] == old_item; ++above) skipped = true;
+
+    int first = (!skipped && sorted[0] == old_item) ? 1 : 0;
+    int last = (!skipped && sorted[s-1] == old_item) ? s-2 : s-1;
+
+    int n = 0;
+    if (below >= 0) {
+        candidates[n++] = sorted[below];
+        candidates[n++] = sorted[first];
+    }
+    if (above < s) {
+        candidates[n++] = sorted[above];
+        candidates[n++] = sorted[last];
+    }
+    return n;
+}
+
+
+// One of the first s items of a stream
+static void fillStream(StreamSet *set, int id, StreamState& state, Value item) {
+
+    Value *window = getStreamWindow(set, id);
+    int *keys = set->keys;
+
+    ++state.count;
+    ++state.pos;
+    window[state.pos] = item;
+
+    int n = state.pos;
+    for (;;) {
+        int minKey = INT_MAX;
+        int maxKey = INT_MIN;
+        for (int j = 0; j < n; ++j) {
+            keys[j] = streamDiffKey(item, window[j], state.sketch, set->gammaAt[state.collapses], set->logGAt[state.collapses]);
+            if (keys[j] != -MIN_KEY) {
+                minKey = std::min(minKey, keys[j]);
+                maxKey = std::max(maxKey, keys[j]);
+            }
+        }//for
+        if (fitStreamKeys(state, minKey, maxKey)) {
+            break;
+        }
+        collapseStream(state);
+    }//for fit
+
+    for (int j = 0; j < n; ++j) {
+        incrementBinCount(keys[j], state.sketch);
+    }//for
+    while (getSketchSize(state.sketch) > set->sketchBound) {
+        collapseStream(state);
+    }//wend
+
+    if (state.pos == set->s-1) {
+        sortWindow(window, getStreamSorted(set, id), set->s);
+    }//fi window full
+}
+
+
+// Slides the full window of a stream by one item: the slot is first fitted to the keys of
+// the new pairs, which lie between those of the nearest and the farthest remaining items,
+// so that the window update of the engine never has to grow it
+static void slideStream(StreamSet *set, int id, StreamState& state, Value item) {
+
+    int s = set->s;
+    Value *window = getStreamWindow(set, id);
+    Value *sorted = getStreamSorted(set, id);
+
+    ++state.count;
+    if (++state.pos == s) {
+        state.pos = 0;
+    }
+    Value oldest_item = window[state.pos];
+    if (oldest_item == item) {
+        return;
+    }
+
+    Value candidates[4];
+    int n = getStreamNeighbours(sorted, s, item, oldest_item, candidates);
+    for (;;) {
+        int minKey = INT_MAX;
+        int maxKey = INT_MIN;
+        for (int i = 0; i < n; ++i) {
+            int key = streamDiffKey(item, candidates[i], state.sketch, set->gammaAt[state.collapses], set->logGAt[state.collapses]);
+            minKey = std::min(minKey, key);
+            maxKey = std::max(maxKey, key);
+        }//for
+        if (fitStreamKeys(state, minKey, maxKey)) {
+            break;
+        }
+        collapseStream(state);
+    }//for fit
+
+    window[state.pos] = item;
+    updateSynopsisWindow(oldest_item, item, window, state.pos, sorted, s, state.sketch, set->gammaAt[state.collapses], set->logGAt[state.collapses]);
+
+    while (getSketchSize(state.sketch) > set->sketchBound) {
+        collapseStream(state);
+    }//wend
+}
+
+
+// Result for the middle item of a full window, as getEngineResult()
+static inline void getStreamResult(StreamSet *set, int id, StreamState& state, Item *result) {
+
+    int s = set->s;
+    Value *window = getStreamWindow(set, id);
+    int middle = (state.pos + 1 + s/2)%s;
+
+    result->seq = state.count - s + 1 + s/2;
+    result->middle = window[middle];
+    result->median = getStreamSorted(set, id)[s/2];
+    result->Qn = set->QnScale * estimateQ(state.sketch, set->quantile, set->gammaAt[state.collapses], set->I);
+    result->isOutlier = (fabs(result->middle - result->median) - (3 * result->Qn)) > 0;
+    result->collapses = state.collapses;
+    result->alpha = set->alphaAt[state.collapses];
+    result->bins = getSketchSize(state.sketch);
+}
+
+
+static inline int pushStreamItem(StreamSet *set, int id, Value item, Item *result) {
+
+    StreamState& state = getStreamState(set, id);
+    if (state.count < set->s) {
+        fillStream(set, id, state, item);
+        memset(result, 0, sizeof(Item));
+        return 0;
+    }//fi warm-up
+
+    slideStream(set, id, state, item);
+    getStreamResult(set, id, state, result);
+    return 1;
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Updates
+
+int pushStream(StreamSet *set, int id, Value item, Item *result) {
+
+    if (id < 0 || id >= set->streams) {
+        return -1;
+    }
+    return pushStreamItem(set, id, item, result);
+}
+
+
+long pushStreamBatch(StreamSet *set, const int *ids, const Value *items, long n, Item *results) {
+
+    for (long i = 0; i < n; ++i) {
+        if (ids[i] < 0 || ids[i] >= set->streams) {
+            return -1;
+        }
+    }//for
+
+    long estimates = 0;
+    for (long first = 0; first < n; first += set->batchCapacity) {
+
+        long last = std::min(n, first + set->batchCapacity);
+
+        // counting sort of the updates by stream, stable so each stream keeps its order
+        long *starts = set->starts;
+        memset(starts, 0, (set->streams+1)*sizeof(long));
+        for (long i = first; i < last; ++i) {
+            ++starts[ids[i]+1];
+        }//for
+        for (int id = 0; id < set->streams; ++id) {
+            starts[id+1] += starts[id];
+        }//for
+        for (long i = first; i < last; ++i) {
+            set->order[starts[ids[i]]++] = i;
+        }//for, starts[id] is now where the updates of id+1 begin
+
+        long k = 0;
+        for (int id = 0; id < set->streams; ++id) {
+            for (; k < starts[id]; ++k) {
+                long i = set->order[k];
+                estimates += pushStreamItem(set, id, items[i], &results[i]);
+            }//for updates of id
+        }//for streams
+    }//for batches
+
+    return estimates;
+}
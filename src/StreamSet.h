@@ -0,0 +1,111 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __STREAMSET_H__
+#define __STREAMSET_H__
+
+#include "DenseSketch.h"
+#include "Utility.h"
+
+const int STREAM_MAX_LEVELS = 64;          // collapse levels tabulated, past them alpha is 1
+
+
+// Scalar state of one stream, one cache line. Its sketch counts are the stream's slot of
+// the set's bucket block: they never grow, the sketch is recentred within the slot instead.
+// The counts pointer is bound to the slot on every access, so the state has a fixed layout
+// and no address and can be stored as it is.
+typedef struct StreamState {
+    DenseSketch sketch;
+    long count;         // items pushed so far
+    int pos;            // ring slot of the newest item
+    int collapses;      // alpha, gamma and logG are those of this collapse level
+} StreamState;
+
+
+// Many small streams with the same window size s, each a full-update engine with the
+// DenseSketch bucketing. The windows, sorted windows and sketch buckets of all of them lie
+// in three contiguous blocks and their scalars in one array, so that a batch of updates
+// grouped by stream touches a few cache lines per stream (in a store file, see openStreamSet(),
+// the four are interleaved instead, a record per stream). A sketch whose keys would span
+// more than capacity buckets is collapsed as if it had exceeded the bound.
+typedef struct StreamSet {
+    int streams;
+    int s;
+    int sketchBound;
+    int capacity;           // buckets per stream
+    int stride;             // items from a window to the next, whole cache lines
+    size_t countStride;     // buckets from a sketch slot to the next
+    size_t stateStride;     // states from a state to the next
+    size_t streamBytes;     // memory of a stream
+
+    Value *windows;         // ring of the last s items of stream i at windows + i*stride
+    Value *sorted;
+    BinCount *counts;
+    StreamState *states;
+
+    double alphaAt[STREAM_MAX_LEVELS];
+    double gammaAt[STREAM_MAX_LEVELS];
+    double logGAt[STREAM_MAX_LEVELS];
+
+    long I;
+    long kth;
+    double quantile;
+    double QnScale;
+
+    long batchCapacity;     // updates grouped at once
+    long *order;            // updates of a batch by stream
+    long *starts;           // first entry of every stream in order, streams+1 of them
+    int *keys;              // keys of the pairs of an item during the warm-up
+
+    void *mapping;          // store file of the blocks, NULL if they are on the heap
+    size_t mappedBytes;
+} StreamSet;
+
+
+
+// Returns 0, or 1 on an invalid configuration (as for initEngine, or capacity < 2)
+int initStreamSet(StreamSet *set, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity);
+
+// Same streams with their state records in the file at path, mapped shared: the kernel pages
+// cold streams out and back in, and the streams go on from where they were when the file
+// is opened again with the same configuration. A new file is created sparse. Returns 0, or
+// 1 on an invalid configuration, a file holding another one, or an I/O error.
+int openStreamSet(StreamSet *set, const char *path, int streams, int s, int sketchBound, double alpha, int capacity, long batchCapacity);
+
+// Writes the mapped streams back to their file; 0, or 1 on an I/O error
+int syncStreamSet(StreamSet *set);
+
+// Frees the set, or unmaps it (the file keeps the streams)
+void destroyStreamSet(StreamSet *set);
+
+// Stream id back to its state before the first item, its slot reused as is
+void resetStream(StreamSet *set, int id);
+
+// Memory held by every stream: its windows, sketch slot and state
+size_t getStreamBytes(StreamSet *set);
+
+// Pushes item to stream id; returns 1 and the result for the middle item of its window,
+// 0 while the window fills, or -1 if id is out of range
+int pushStream(StreamSet *set, int id, Value item, Item *result);
+
+// Pushes the n updates (ids[i], items[i]), each stream in the order given, and writes the
+// result of update i in results[i], with seq 0 while its stream fills. Returns the number
+// of results with an estimate, or -1 if an id is out of range (nothing is pushed then).
+long pushStreamBatch(StreamSet *set, const int *ids, const Value *items, long n, Item *results);
+
+
+#endif //__STREAMSET_H__
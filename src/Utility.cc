@@ -16,19 +16,25 @@
 
 
 #include "Utility.h"
+#include "DDSketch.h"
 #include <cstring>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-extern double NULLBOUND;
-extern char VERSION[];  
 
 // ******************************************************* DEBUG LOG
 
-void logStartup(int s, int sketchBound, long N, int I, int kth, double quantile, int diff_frac, double currentAlpha, double currentGamma,  double QnScale) {
+void logStartup(int s, int sketchBound, long N, long I, long kth, double quantile, int diff_frac, double currentAlpha, double currentGamma,  double QnScale, const char *banner) {
     
     std::cout << "\n\tApproximate Online Qn estimator, version "<< VERSION << std::endl;
     std::cout << "\tWindow size: " << s << std::endl; 
@@ -43,15 +49,7 @@ void logStartup(int s, int sketchBound, long N, int I, int kth, double quantile,
     std::cout<< "\n"<< std::endl;
     std::cout <<  "\t EXACT MEDIAN ESTIMATION\n";
 
-    #ifdef TEST
-        std::cout << "\t -----> TESTING MODE <-----\n\n";
-    #elif DEBUG
-        std::cout <<  "\t ***** DEBUG MODE *****\n\n";
-    #elif VERIFY
-        std::cout <<  "\t ***** VERIFY MODE *****\n\n";
-    #else
-        std::cout <<  "\t ++++++ CHECK MODE ++++++\n\n";
-    #endif
+    std::cout << "\t " << banner << "\n\n";
 }
 
 
@@ -96,14 +94,14 @@ double getExactKth(std::vector<double>& array, int kth) {
 }
 
 
-double checkApproximationError(double estimate, double exact, std::string msg) {
+double checkApproximationError(double estimate, double exact, std::string msg, bool verbose) {
     double error = std::abs((estimate-exact)/exact);  // approximation relative error  
     
-    #ifdef DEBUG
+    if (verbose) {
         std::cout << msg << ": Exact value = " << exact;
         std::cout << " \tApproximate value = " << estimate;
         std::cout << " \tRelative Error (α) = " << error << std::endl;
-    #endif
+    }
 
     return error;
 }
@@ -121,92 +119,27 @@ void initDefault(int *window_size, int *sketch_bound, int *streamLen, double *in
 void printUsage(char *msg) {
     std::cerr << "Usage: " << msg << " {[-f path-to-file] | [-d distribution_type] [-x distribution_param] [-y distribution_param]} ";
     std::cerr << "[-s window_size] ";
-    std::cerr << "[ -n max_stream_len ] [ -a initial_alpha ] [-b max_sketch_bound]\n\n" << std::endl;
+    std::cerr << "[ -n max_stream_len ] [ -a initial_alpha ] [-b max_sketch_bound] [-o output] [-v validation] [-t diff_fraction] [-u selection] [-w threads] [-k max_keys] [-i idle_timeout] [-p batch]\n\n" << std::endl;
     
     std::cerr << " -n is the len of the stream for the online phase (total items N = n+s)\n";
     std::cerr << " -d can be: \n";
     std::cerr << " : 1 Uniform distribution, with params [a:b] given by -x and -y options\n";
     std::cerr << " : 2 Exponential distribution, with params [λ] given by -x option\n";
     std::cerr << " : 3 Normal distribution, with params [µ:σ] given by -x and -y options\n";
+    std::cerr << " -o can be: cmp (default, a row per item in Results/), buffer (outliers kept in memory), file (outliers written as found)\n";
+    std::cerr << " -v can be: none (default), exact (all the differences kept and checked), trace (exact, printing every error)\n";
+    std::cerr << " -t refreshes only (s-1)/t of the differences of every item (partial update), 1 all of them (default)\n";
+    std::cerr << " -u selects the differences of a partial update: 0 nearest (default), 1 uniform\n";
+    std::cerr << " -w splits the full update of every item over threads spinning between items, for windows of many thousands\n";
+    std::cerr << " -k reads series_id,timestamp,value records of up to max_keys live series, one window each (-n records at most)\n";
+    std::cerr << " -i evicts the series without records for idle_timeout (timestamp units), 0 only to make room (default)\n";
+    std::cerr << " -p reads, processes and logs the stream on three threads handing over batches of this many items (with -o cmp)\n";
     std::cerr << "\n";
 }
 
 
 
-void parseCommandLine(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, int *diff_fraction, Counters *stats){
-	
-    if (!stats) {
-        fprintf(stderr, "ERROR: Counters variable is NULL\n");
-        exit(1);
-    }
-    
-    (*window_size) = DEFAULT_WINDOW_SIZE;
-    (*sketch_bound) = 0; 
-    (*initial_alpha) = Alpha_0;
-    stats->MaxStreamLen = STREAMLEN;
-    (*diff_fraction) = -1;
-
-    bool file_flag = false;
-    int t=-1;
-    int c=0;
-    while ( (c = getopt(argc, argv, "f:s:b:a:n:t:")) != -1) {
-        
-        switch (c) {
-            
-            case 'f':
-                if (strlen(optarg) <= FSIZE) {
-                    stats->filename = strndup(optarg, strlen(optarg));
-                }
-                file_flag = true;
-                break;
-
-            case 'n':
-                stats->MaxStreamLen = strtol(optarg, NULL, 10);
-                break;
-
-            case 's':
-				(*window_size) = atoi(optarg);
-                break;        
-
-            case 'b':
-                (*sketch_bound) = atoi(optarg);
-                break;
-            
-            case 'a':
-                (*initial_alpha) = strtod(optarg, NULL); 
-                break;
-
-            case 't':
-                t = atoi(optarg);
-                break;
-
-            default:
-                fprintf(stderr, "?? getopt returned character code 0%o ??\n", c);
-                break;
-        }// switch
-    }//wend
-
-	#ifdef TEST
-        if (!file_flag){
-            std::cerr << "ERROR: a file with input data MUST be provided, -f path-to-file " << std::endl;
-            exit(1);
-        }
-    #endif
-
-    if ((*sketch_bound) == 0) {
-        (*sketch_bound) = 2 * (*window_size);
-    }
-
-    if (t == -1) {
-        t = 1; 
-    } 
-    (*diff_fraction) = std::ceil((double) ((*window_size) - 1 )/(t*1.0));
-
-}
-
-
-
-int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, Counters *stats){
+int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, RunModes *modes, Counters *stats){
 	
     int invalidRes = 1;
 
@@ -221,6 +154,15 @@ int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int
     stats->streamLen = 0;
     stats->MaxStreamLen = 0;    
 
+    modes->output = COMPARE_OUTPUT;
+    modes->validation = NO_VALIDATION;
+    modes->selection = NEAREST_SELECTION;
+    modes->diffFraction = 1;
+    modes->windowThreads = 1;
+    modes->maxKeys = 0;
+    modes->idleTimeout = 0.0;
+    modes->pipeBatch = 0;
+
     bool file_flag = false;
     
     int distrtype = 0;
@@ -228,7 +170,7 @@ int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int
     bool dist_flag = false;
     
     int c=0;
-    while ( (c = getopt(argc, argv, "f:s:b:a:n:d:x:y:")) != -1) 
+    while ( (c = getopt(argc, argv, "f:s:b:a:n:d:x:y:o:v:t:u:w:k:i:p:")) != -1) 
     {
         
         switch (c) 
@@ -270,6 +212,56 @@ int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int
                 yparam = strtod(optarg, NULL); 
                 break;
 
+            case 'o':
+                if (!strcmp(optarg, "cmp")) {
+                    modes->output = COMPARE_OUTPUT;
+                } else if (!strcmp(optarg, "buffer")) {
+                    modes->output = BUFFERED_OUTPUT;
+                } else if (!strcmp(optarg, "file")) {
+                    modes->output = FILE_OUTPUT;
+                } else {
+                    fprintf(stderr, "ERROR: unrecognized output %s (can be cmp, buffer or file)\n", optarg);
+                    return invalidRes;
+                }
+                break;
+
+            case 'v':
+                if (!strcmp(optarg, "none")) {
+                    modes->validation = NO_VALIDATION;
+                } else if (!strcmp(optarg, "exact")) {
+                    modes->validation = EXACT_VALIDATION;
+                } else if (!strcmp(optarg, "trace")) {
+                    modes->validation = TRACE_VALIDATION;
+                } else {
+                    fprintf(stderr, "ERROR: unrecognized validation %s (can be none, exact or trace)\n", optarg);
+                    return invalidRes;
+                }
+                break;
+
+            case 't':
+                modes->diffFraction = atoi(optarg);
+                break;
+
+            case 'u':
+                modes->selection = atoi(optarg) ? UNIFORM_SELECTION : NEAREST_SELECTION;
+                break;
+
+            case 'w':
+                modes->windowThreads = atoi(optarg);
+                break;
+
+            case 'k':
+                modes->maxKeys = atoi(optarg);
+                break;
+
+            case 'i':
+                modes->idleTimeout = strtod(optarg, NULL);
+                break;
+
+            case 'p':
+                modes->pipeBatch = strtol(optarg, NULL, 10);
+                break;
+
             default:
                 fprintf(stderr, "?? getopt returned character code 0%o ??\n", c);
                 break;
@@ -282,11 +274,21 @@ int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int
         return invalidRes;
     }
 
+    if (*initial_alpha < MIN_ALPHA || *initial_alpha >= 1.0) {
+        fprintf(stderr, "ERROR: α must be in [%g, 1)\n", MIN_ALPHA);
+        return invalidRes;
+    }
+
     if (! *window_size) {
         fprintf(stderr, "ERROR: window size not defined\n");
         return invalidRes;
     }
 
+    if (modes->diffFraction < 1 || modes->diffFraction > (*window_size)-1) {
+        fprintf(stderr, "ERROR: diff fraction must be between 1 and s-1\n");
+        return invalidRes;
+    }
+
     if (! *sketch_bound) {
         fprintf(stderr, "ATTENTION: sketch bound not defined: setting on behalf of the window size\n");
         (*sketch_bound) = 2 * (*window_size);
@@ -309,44 +311,53 @@ int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int
         return invalidRes;
     }
 
+    if (modes->windowThreads < 1 || (modes->windowThreads > 1 && modes->diffFraction > 1)) {
+        fprintf(stderr, "ERROR: window threads (-w) must be at least 1, and split full updates only (-t 1)\n");
+        return invalidRes;
+    }
 
-    #ifdef TEST
-        
-        if (!file_flag) {
-            fprintf(stderr, "ERROR: in TEST Mode we want input from a file\n");;
+    if (modes->maxKeys < 0 || modes->idleTimeout < 0.0) {
+        fprintf(stderr, "ERROR: max keys and idle timeout cannot be negative\n");
+        return invalidRes;
+    }
+
+    if (modes->maxKeys && (!file_flag || modes->validation != NO_VALIDATION || modes->diffFraction > 1)) {
+        fprintf(stderr, "ERROR: keyed records (-k) are read from a file (-f), with full updates (-t 1) and no validation (-v none)\n");
+        return invalidRes;
+    }
+
+    if (modes->pipeBatch < 0 || (modes->pipeBatch && (modes->maxKeys || modes->output != COMPARE_OUTPUT || modes->validation != NO_VALIDATION))) {
+        fprintf(stderr, "ERROR: the pipeline (-p) takes a positive batch and logs one stream (no -k) with -o cmp and -v none\n");
+        return invalidRes;
+    }
+
+
+    if (dist_flag) 
+    {
+        if (distrtype < 1 || distrtype > 3){
+            fprintf(stderr, "ERROR: unrecognized distribution type (can be 1 or 2 or 3)\n");
             return invalidRes;
         }
-    
-    #else
 
-        if (dist_flag) 
-        {
-            if (distrtype < 1 || distrtype > 3){
-                fprintf(stderr, "ERROR: unrecognized distribution type (can be 1 or 2 or 3)\n");
-                return invalidRes;
-            }
-
-            if (distrtype == 1 && ((xparam==0.0 && yparam==0.0) || (xparam >= yparam)) ) {
-                fprintf(stderr, "ERROR: incorrect setting the range [a,b) for Uniform distribution\n");
-                return invalidRes;
-            }
-
-            if (distrtype == 2 && xparam==0.0) {
-                fprintf(stderr, "ERROR: incorrect setting the λ value for Exponential distribution\n");
-                return invalidRes;
-            }
-
-            if (distrtype == 3 && (xparam==0.0 && yparam==0.0) ) {
-                fprintf(stderr, "ERROR: incorrect setting mean (μ) and stddev (σ) for Normal distribution\n");
-                return invalidRes;
-            }
-
-            stats->dtype = distrtype;
-            stats->xparam = xparam;
-            stats->yparam = yparam;
-        }//fi dist_flag
+        if (distrtype == 1 && ((xparam==0.0 && yparam==0.0) || (xparam >= yparam)) ) {
+            fprintf(stderr, "ERROR: incorrect setting the range [a,b) for Uniform distribution\n");
+            return invalidRes;
+        }
 
-    #endif
+        if (distrtype == 2 && xparam==0.0) {
+            fprintf(stderr, "ERROR: incorrect setting the λ value for Exponential distribution\n");
+            return invalidRes;
+        }
+
+        if (distrtype == 3 && (xparam==0.0 && yparam==0.0) ) {
+            fprintf(stderr, "ERROR: incorrect setting mean (μ) and stddev (σ) for Normal distribution\n");
+            return invalidRes;
+        }
+
+        stats->dtype = distrtype;
+        stats->xparam = xparam;
+        stats->yparam = yparam;
+    }//fi dist_flag
 
 return 0;
 }
@@ -363,7 +374,7 @@ void bufferStreamFromFile(Counters *stats) {
             exit(1);
         }
 
-        stats->item_points = (double *)malloc( sizeof(double) * stats->MaxStreamLen); 
+        stats->item_points = (Value *)malloc( sizeof(Value) * stats->MaxStreamLen); 
         
         char *line = NULL;
         size_t dim = 0;
@@ -382,6 +393,42 @@ void bufferStreamFromFile(Counters *stats) {
 
 
 
+// Draws the whole stream before processing starts, so that the main loop reads its
+// items from item_points whatever their source
+void bufferStreamFromDistribution(Counters *stats) {
+
+    std::function<double()> randomizer = getStreamDistribution(stats);
+    stats->item_points = (Value *)malloc( sizeof(Value) * stats->MaxStreamLen); 
+    for (long idx = 0; idx < stats->MaxStreamLen; ++idx) {
+        stats->item_points[idx] = randomizer();
+    }//for
+}
+
+
+std::function<double()> getStreamDistribution(Counters *stats) {
+
+    std::default_random_engine generator;
+    generator.seed(std::chrono::system_clock::now().time_since_epoch().count());
+
+    const char *name;
+    std::function<double()> randomizer;
+    if (stats->dtype == 1) {
+        name = "Uniform";
+        randomizer = std::bind(std::uniform_real_distribution<double>(stats->xparam, stats->yparam), generator);
+    } else if (stats->dtype == 2) {
+        name = "Exponential";
+        randomizer = std::bind(std::exponential_distribution<double>(stats->xparam), generator);
+    } else {
+        name = "Normal";
+        randomizer = std::bind(std::normal_distribution<double>(stats->xparam, stats->yparam), generator);
+    }//fi dtype
+
+    stats->filename = strndup(name, strlen(name));
+    return randomizer;
+}
+
+
+
 void initOutliersStats(Counters *stats) {
 
     stats->filename = NULL;
@@ -402,19 +449,17 @@ void initOutliersStats(Counters *stats) {
 
     stats->fpO = stats->fpI = NULL;
     
-    #ifndef TEST
-        stats->fpExactO = NULL;
-        stats->fpExactI = NULL;
+    stats->fpExactO = NULL;
+    stats->fpExactI = NULL;
 
-        stats->exact_out_count = 0;
-        stats->exact_in_count = 0;
+    stats->exact_out_count = 0;
+    stats->exact_in_count = 0;
         
-        stats->exac_outF = NULL;
-        stats->exac_inF = NULL;
-    #else
-        stats->outliersBuffer = NULL;
-        stats->inliersBuffer = NULL; 
-    #endif
+    stats->exac_outF = NULL;
+    stats->exac_inF = NULL;
+
+    stats->outliersBuffer = NULL;
+    stats->inliersBuffer = NULL; 
 }
 
 void initResultFilename(Counters *stats, int window_size, int tsize) {
@@ -439,25 +484,45 @@ void initResultFilename(Counters *stats, int window_size, int tsize) {
 
 void initExactFilename(Counters *stats, int window_size, int tsize) {
 
-    #ifndef TEST
-        if (stats!= NULL && stats->filename != NULL) {
-            std::string name = stats->filename;
-            std::size_t pos = name.find_last_of("/"); 
-            std::string distr = name.substr(pos+1, 4); 
+    if (stats!= NULL && stats->filename != NULL) {
+        std::string name = stats->filename;
+        std::size_t pos = name.find_last_of("/"); 
+        std::string distr = name.substr(pos+1, 4); 
     
-            std::string n1 = "";
-            std::string n2 = "";
+        std::string n1 = "";
+        std::string n2 = "";
 
-            n1 += "./" + distr + "-ExactOutlier-" + std::to_string(window_size) + "-" + std::to_string(tsize) + ".csv";
-            n2 += "./" + distr + "-ExactInlier-" + std::to_string(window_size) + "-" + std::to_string(tsize) + ".csv";
+        n1 += "./" + distr + "-ExactOutlier-" + std::to_string(window_size) + "-" + std::to_string(tsize) + ".csv";
+        n2 += "./" + distr + "-ExactInlier-" + std::to_string(window_size) + "-" + std::to_string(tsize) + ".csv";
 
-            stats->exac_outF = new char[n1.length()+1];
-            std::strcpy(stats->exac_outF, n1.c_str());
+        stats->exac_outF = new char[n1.length()+1];
+        std::strcpy(stats->exac_outF, n1.c_str());
                 
-            stats->exac_inF = new char[n2.length()+1];
-            std::strcpy(stats->exac_inF, n2.c_str());
-        }//fi
-    #endif  
+        stats->exac_inF = new char[n2.length()+1];
+        std::strcpy(stats->exac_inF, n2.c_str());
+    }//fi
+}
+
+
+void getCompareFilename(Counters *stats, int window_size, int tsize, char *fname) {
+
+    const char *sub = strrchr(stats->filename, '/');
+    sub = (sub == NULL) ? stats->filename : sub + 1;
+        
+    int len = strlen(sub);
+    char stripped[len+1];
+    strncpy(stripped, sub, len+1);
+    char *ext = strrchr(stripped, '.');
+    if (ext != NULL) {
+        *ext = '\0';
+    }
+        
+    snprintf(fname, FSIZE-1, "Results/%s-%d-%d.csv", stripped, window_size, tsize);
+}
+
+
+void logItem(FILE *fp, const Item *item) {
+    fprintf(fp, "%ld,%.6f,%.6f,%.6f,%d,%d,%.6f,%d\n", item->seq, item->middle, item->median, item->Qn, item->isOutlier, item->collapses, item->alpha, item->bins);
 }
 
 
@@ -481,59 +546,60 @@ void openLog(Counters *stats) {
         fprintf(stats->fpI, "%s,%s,%s,%s,%s,%s,,%s\n", "seqNo", "item", "Median", "Q1", "z-score", "collapse", "alpha");
     }
 
-    #ifdef TEST
-        stats->outliersBuffer = (Item *)malloc(sizeof(Item)*stats->MaxStreamLen);                           
-        stats->inliersBuffer  = (Item *)malloc(sizeof(Item)*stats->MaxStreamLen); 
-    #else 
-        stats->fpExactO = NULL;
-        stats->fpExactI = NULL;            
-
-        if (stats->exac_outF){
-            stats->fpExactO = fopen(stats->exac_outF, "w");
-            if (stats->fpExactO == NULL) {
-                fprintf(stderr, "Error opening %s\n",stats->exac_outF);
-                exit(1);
-            } 
-            fprintf(stats->fpExactO, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "seqNo", "item", "Median", "K-th", "Q1", "relErr", "Qn", "z-score", "collapse", "#bins", "alpha");
-        }
+    if (stats->exac_outF){
+        stats->fpExactO = fopen(stats->exac_outF, "w");
+        if (stats->fpExactO == NULL) {
+            fprintf(stderr, "Error opening %s\n",stats->exac_outF);
+            exit(1);
+        } 
+        fprintf(stats->fpExactO, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "seqNo", "item", "Median", "K-th", "Q1", "relErr", "Qn", "z-score", "collapse", "#bins", "alpha");
+    }
 
-        if (stats->exac_inF){
-            stats->fpExactI = fopen(stats->exac_inF, "w");
-            if (stats->fpExactI == NULL) {
-                fprintf(stderr, "Error opening %s\n",stats->exac_inF);
-                exit(1);
-            } 
-            fprintf(stats->fpExactI, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "seqNo", "item", "Median", "K-th", "Q1", "relErr", "Qn", "z-score", "collapse", "#bins", "alpha");
-        }
-    #endif 
+    if (stats->exac_inF){
+        stats->fpExactI = fopen(stats->exac_inF, "w");
+        if (stats->fpExactI == NULL) {
+            fprintf(stderr, "Error opening %s\n",stats->exac_inF);
+            exit(1);
+        } 
+        fprintf(stats->fpExactI, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "seqNo", "item", "Median", "K-th", "Q1", "relErr", "Qn", "z-score", "collapse", "#bins", "alpha");
+    }
+}
+
+
+
+// Buffers of OutlierTest(), written out by closeLog()
+void openOutlierBuffers(Counters *stats) {
+
+    stats->outliersBuffer = (Item *)malloc(sizeof(Item)*stats->MaxStreamLen);                           
+    stats->inliersBuffer  = (Item *)malloc(sizeof(Item)*stats->MaxStreamLen); 
 }
 
 
 void closeLog(Counters *stats) {
 
-    #ifdef TEST
-        if (stats->outliersBuffer){
-            for(long u = 0; u<(stats->approx_out_count); ++u) {
-                fprintf(stats->fpO, "%ld,%.6f\n", stats->outliersBuffer[u].seq, stats->outliersBuffer[u].middle);
-            } 
-            free(stats->outliersBuffer);
-        }
+    if (stats->outliersBuffer){
+        for(long u = 0; u<(stats->approx_out_count); ++u) {
+            fprintf(stats->fpO, "%ld,%.6f\n", stats->outliersBuffer[u].seq, stats->outliersBuffer[u].middle);
+        } 
+        free(stats->outliersBuffer);
+        stats->outliersBuffer = NULL;
+    }
             
-        if (stats->inliersBuffer){
-            for(long u = 0; u<(stats->approx_in_count); ++u) {
-                fprintf(stats->fpI, "%ld,%.6f\n", stats->inliersBuffer[u].seq, stats->inliersBuffer[u].middle);
-            } 
-            free(stats->inliersBuffer);
-        }
-    #else
-        if (stats->fpExactO) {
-            fclose(stats->fpExactO);
-        }
+    if (stats->inliersBuffer){
+        for(long u = 0; u<(stats->approx_in_count); ++u) {
+            fprintf(stats->fpI, "%ld,%.6f\n", stats->inliersBuffer[u].seq, stats->inliersBuffer[u].middle);
+        } 
+        free(stats->inliersBuffer);
+        stats->inliersBuffer = NULL;
+    }
+
+    if (stats->fpExactO) {
+        fclose(stats->fpExactO);
+    }
         
-        if (stats->fpExactI) {
-            fclose(stats->fpExactI);
-        }
-    #endif
+    if (stats->fpExactI) {
+        fclose(stats->fpExactI);
+    }
 
     if (stats->fpO) {
         fclose(stats->fpO);
@@ -566,15 +632,13 @@ void destroyOutliersStats(Counters *stats) {
             free(stats->item_points);
         }
  
-        #ifndef TEST
-            if (stats->exac_outF) {
-                delete stats->exac_outF;
-            }
+        if (stats->exac_outF) {
+            delete stats->exac_outF;
+        }
             
-            if (stats->exac_inF) {
-                delete stats->exac_inF;
-            }
-        #endif
+        if (stats->exac_inF) {
+            delete stats->exac_inF;
+        }
     }//fi
 }
 
@@ -629,22 +693,12 @@ void checkForOutlier(double middle, long seqNo, double median, double Q1, Counte
     
     if ( zscore > 0) {
         
-		#ifndef TEST
-			fprintf(stats->fpO, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, median, Q1, zscore, collapse, bins, alpha);
-        #else
-            stats->outliersBuffer[stats->approx_out_count].seq = seqNo;
-            stats->outliersBuffer[stats->approx_out_count].middle = middle;    
-		#endif
+		fprintf(stats->fpO, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, median, Q1, zscore, collapse, bins, alpha);
         
         ++stats->approx_out_count;
 	} else {
         
-        #ifndef TEST
-			fprintf(stats->fpI, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, median, Q1, zscore, collapse, bins, alpha);
-        #else
-            stats->inliersBuffer[stats->approx_in_count].seq = seqNo;
-            stats->inliersBuffer[stats->approx_in_count].middle = middle;     
-		#endif
+		fprintf(stats->fpI, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, median, Q1, zscore, collapse, bins, alpha);
         
         ++stats->approx_in_count;
     }//fi check test
@@ -662,20 +716,16 @@ void exactOutlier(double middle, long seqNo, double exactM, double exactK, Count
 
     if (zscore > 0) {
             
-        #ifndef TEST
-            ++stats->exact_out_count;
+        ++stats->exact_out_count;
 
-            fprintf(stats->fpExactO, "%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, exactM, 
-            exactK, apprK, errQ, Qn, zscore, collapse, bins, alpha);
-        #endif
+        fprintf(stats->fpExactO, "%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, exactM, 
+        exactK, apprK, errQ, Qn, zscore, collapse, bins, alpha);
 	} else {
 
-        #ifndef TEST
-            ++stats->exact_in_count;
+        ++stats->exact_in_count;
 		
-        	fprintf(stats->fpExactI, "%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, exactM, 
-            exactK, apprK, errQ, Qn, zscore, collapse, bins, alpha);
-        #endif
+        fprintf(stats->fpExactI, "%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n", seqNo, middle, exactM, 
+        exactK, apprK, errQ, Qn, zscore, collapse, bins, alpha);
     }//fi check test
 }
 
@@ -689,21 +739,13 @@ void OutlierTest(double middle, long seqNo, double median, double Q1, Counters *
 
     if (zscore > 0) {
 
-    	#ifdef TEST
-            stats->outliersBuffer[stats->approx_out_count].seq = seqNo;
-            stats->outliersBuffer[stats->approx_out_count].middle = middle;    
-        #else
-    		fprintf(stats->fpO, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%.6f\n", seqNo , middle, median, Q1, zscore, collapse, alpha);
-		#endif
+        stats->outliersBuffer[stats->approx_out_count].seq = seqNo;
+        stats->outliersBuffer[stats->approx_out_count].middle = middle;    
         ++stats->approx_out_count;
 	} else {
 
-        #ifdef TEST
-            stats->inliersBuffer[stats->approx_in_count].seq = seqNo;
-            stats->inliersBuffer[stats->approx_in_count].middle = middle;    
-        #else 
-            fprintf(stats->fpI, "%ld,%.6f,%.6f,%.6f,%.6f,%d,%.6f\n", seqNo , middle, median, Q1, zscore, collapse, alpha);
-        #endif
+        stats->inliersBuffer[stats->approx_in_count].seq = seqNo;
+        stats->inliersBuffer[stats->approx_in_count].middle = middle;    
         ++stats->approx_in_count;
     }//fi check test
 }
@@ -745,3 +787,31 @@ double getElapsedSeconds(Timer *t){
     }
 }
 
+
+
+// ****************** Memory
+
+void *allocateAligned(size_t bytes) {
+
+    void *p = NULL;
+    if (posix_memalign(&p, MEMORY_ALIGNMENT, std::max(bytes, MEMORY_ALIGNMENT)) != 0) {
+        std::cerr << "ERROR: unable to allocate " << bytes << " bytes" << std::endl;
+        exit(1);
+    }
+    return p;
+}
+
+
+
+// ****************** Threads
+
+void spinWait(int *spins) {
+
+    if (++(*spins) < SPIN_LIMIT) {
+        #if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+        #endif
+    } else {
+        std::this_thread::yield();
+    }
+}
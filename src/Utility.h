@@ -26,17 +26,33 @@
 #include <map>
 #include <vector>
 #include <utility>
+#include <functional>
 
 #include <stdio.h>
 #include <sys/time.h>
 
 
+// Stream items and the windows holding them; -DFLOAT32 halves their footprint,
+// -DINT32 is for integer streams, whose differences are exact and keyed by table
+#if defined(FLOAT32) && defined(INT32)
+    #error "FLOAT32 and INT32 are alternative item types"
+#elif defined(FLOAT32)
+    typedef float Value;
+#elif defined(INT32)
+    typedef int Value;
+#else
+    typedef double Value;
+#endif
+
 const int DEFAULT_WINDOW_SIZE = 1001;           
 const int STREAMLEN = 1001;     
 const int PARSING_ERROR = 7;                    
 const int FSIZE = 256;                          
 const double QFactor = 2.2219;                  
 const double Alpha_0 = 0.001;                   
+const double MIN_ALPHA = 1e-6;                  // smallest alpha whose null bound (see DDSketch.h) is 0
+
+const char VERSION[] = "AFQNv1";
 
 
 
@@ -95,7 +111,7 @@ typedef struct Counters {
     FILE *fpO;                  
     FILE *fpI;                  
     
-    double *item_points;        
+    Value *item_points;         
     long streamLen;             
     long MaxStreamLen;          
     
@@ -104,26 +120,57 @@ typedef struct Counters {
     int approx_out_count;       
     int approx_in_count;        
 
-    #ifndef TEST
-        FILE *fpExactO;         
-        FILE *fpExactI;         
-        char *exac_outF;        
-        char *exac_inF;         
-        int exact_out_count;    
-        int exact_in_count;     
-    #else  
-        Item *outliersBuffer;   
-        Item *inliersBuffer;    
-    #endif 
+    FILE *fpExactO;             // exact validation only
+    FILE *fpExactI;         
+    char *exac_outF;        
+    char *exac_inF;         
+    int exact_out_count;    
+    int exact_in_count;     
+
+    Item *outliersBuffer;       // buffered output only
+    Item *inliersBuffer;    
 
 } Counters;
 
 
 
+// Execution modes chosen on the command line, each one a policy type of the main loop
+// (see Policies.h): where the estimates go, what is checked against the exact
+// differences, and which differences a partial update refreshes
+typedef enum OutputMode {
+    COMPARE_OUTPUT = 0,         // -o cmp: one row per item in Results/, for comparison against FQN
+    BUFFERED_OUTPUT = 1,        // -o buffer: outliers and inliers kept in memory, written at the end
+    FILE_OUTPUT = 2             // -o file: outliers and inliers written as they are found
+} OutputMode;
+
+typedef enum ValidationMode {
+    NO_VALIDATION = 0,          // -v none: processing only
+    EXACT_VALIDATION = 1,       // -v exact: all the differences kept, exact quantiles and outliers logged
+    TRACE_VALIDATION = 2        // -v trace: exact validation printing every approximation error
+} ValidationMode;
+
+typedef enum SelectionMode {
+    NEAREST_SELECTION = 0,      // -u 0: the differences with the nearest items of the sorted window
+    UNIFORM_SELECTION = 1       // -u 1: one difference every (s-1)/ndiffs items
+} SelectionMode;
+
+typedef struct RunModes {
+    OutputMode output;
+    ValidationMode validation;
+    SelectionMode selection;
+    int diffFraction;           // -t: a partial update refreshes ceil((s-1)/t) differences per item, 1 all of them
+    int windowThreads;          // -w: threads the full update of an item is split over, 1 none
+    int maxKeys;                // -k: keyed records, at most this many live series, 0 a single series
+    double idleTimeout;         // -i: series without records for longer are evicted, 0 only to make room
+    long pipeBatch;             // -p: items per batch of the ingest, engine and output threads, 0 a single thread
+} RunModes;
+
+
+
 
 // ******************** DEBUG VIEWS
 
-void logStartup(int s, int sketchBound, long N, int I, int kth, double quantile, int diff_frac, double currentAlpha, double currentGamma,  double QnScale);
+void logStartup(int s, int sketchBound, long N, long I, long kth, double quantile, int diff_frac, double currentAlpha, double currentGamma,  double QnScale, const char *banner);
 
 
 
@@ -143,7 +190,7 @@ void debugDifferences(double diff, int key, double alpha, double gamma, double l
 double getExactKth(std::vector<double>& array, int kth);
 
 
-double checkApproximationError(double estimate, double exact, std::string msg);
+double checkApproximationError(double estimate, double exact, std::string msg, bool verbose);
 
 
 
@@ -152,19 +199,23 @@ double checkApproximationError(double estimate, double exact, std::string msg);
 
 void printUsage(char *msg);
 
-void parseCommandLine(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, int *diff_fraction, Counters *stats);
-
-
-int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, Counters *stats);
+int checkCommandLineConfiguration(int argc, char *argv[], int *window_size, int *sketch_bound, double *initial_alpha, RunModes *modes, Counters *stats);
 
 // ******************** Files management 
 
 void bufferStreamFromFile(Counters *stats);
 
+void bufferStreamFromDistribution(Counters *stats);
+
+// Draws of the -d distribution, naming the stream after it
+std::function<double()> getStreamDistribution(Counters *stats);
+
 void initOutliersStats(Counters *stats);
 
 void openLog(Counters *stats);
 
+void openOutlierBuffers(Counters *stats);
+
 void closeLog(Counters *stats);
 
 void destroyOutliersStats(Counters *stats);
@@ -173,6 +224,12 @@ void initResultFilename(Counters *stats, int window_size, int tsize);
 
 void initExactFilename(Counters *stats, int window_size, int tsize);
 
+// Results/<stream>-<s>-<bound>.csv, the -o cmp log
+void getCompareFilename(Counters *stats, int window_size, int tsize, char *fname);
+
+// A row of the -o cmp log
+void logItem(FILE *fp, const Item *item);
+
 // ******************** Outlierness
 
 double getQnScaleFactor(int n, double scalingFactor);
@@ -202,4 +259,19 @@ double getElapsedMilliSecs(Timer *t);
 double getElapsedSeconds(Timer *t);
 
 
+// ****************** Memory
+
+const size_t MEMORY_ALIGNMENT = 64;             // a cache line, and the widest vector load
+
+void *allocateAligned(size_t bytes);
+
+
+// ****************** Threads
+
+const int SPIN_LIMIT = 1 << 12;                 // busy waits before a waiting thread yields its core
+
+// One round of a wait loop on another thread: a pause, or a yield past SPIN_LIMIT rounds
+void spinWait(int *spins);
+
+
 #endif //__UTILITY_H__
@@ -0,0 +1,727 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "WindowKernel.h"
+#include "DDSketch.h"
+#include "FastKey.h"
+#include "IntKey.h"
+#include "LogLinearSketch.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Dispatch
+
+KernelLevel getKernelLevel() {
+
+    #if defined(X86_KERNELS) && !defined(SCALAR)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+            return AVX512_KERNEL;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return AVX2_KERNEL;
+        }
+    #endif
+    return SCALAR_KERNEL;
+}
+
+
+const char *getKernelName(KernelLevel level) {
+
+    switch (level) {
+        case AVX512_KERNEL:
+            return "AVX-512";
+        case AVX2_KERNEL:
+            return "AVX2";
+        default:
+            return "scalar";
+    }//switch
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Scalar kernel
+
+static inline int keyOf(double diff, double scale, double gamma, double logG) {
+
+    int key;
+    if (diff > NULLBOUND && fastKey(diff, scale, &key)) {
+        return key;
+    }
+    return getKeyFor(diff, gamma, logG);
+}
+
+
+// T is double or float: the difference is taken in T, its key computed in double
+template <class T>
+static int scalarKeyDeltas(const T *window, int from, int to, T new_item, T old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    double scale = LOG10_2/logG;
+    int n = 0;
+
+    for (int j = from; j < to; ++j) {
+        int keyA = keyOf(std::abs(window[j] - new_item), scale, gamma, logG);
+        int keyR = keyOf(std::abs(window[j] - old_item), scale, gamma, logG);
+
+        keysA[n] = keyA;
+        keysR[n] = keyR;
+        n += (keyA != keyR);
+    }//for
+
+    return n;
+}
+
+
+// Reference keys for the lanes of w[0..lanes) whose bit is clear in ok
+template <class T>
+static inline void fallbackKeys(const T *w, int lanes, int ok, T new_item, T old_item, double gamma, double logG, int *a, int *r) {
+
+    for (int l = 0; l < lanes; ++l) {
+        if (!(ok & (1 << l))) {
+            a[l] = getKeyFor(std::abs(w[l] - new_item), gamma, logG);
+            r[l] = getKeyFor(std::abs(w[l] - old_item), gamma, logG);
+        }
+    }//for l
+}
+
+
+static inline double linearDiff(double a, double b) {
+    return std::abs(a - b);
+}
+
+static inline double linearDiff(float a, float b) {
+    return std::abs(a - b);
+}
+
+static inline double linearDiff(int a, int b) {
+    return intDiff(a, b);
+}
+
+
+template <class T>
+static int scalarLinearKeyDeltas(const T *window, int from, int to, T new_item, T old_item, int shift, int *keysA, int *keysR) {
+
+    int n = 0;
+
+    for (int j = from; j < to; ++j) {
+        int keyA = getLinearKey(linearDiff(window[j], new_item), shift);
+        int keyR = getLinearKey(linearDiff(window[j], old_item), shift);
+
+        keysA[n] = keyA;
+        keysR[n] = keyR;
+        n += (keyA != keyR);
+    }//for
+
+    return n;
+}
+
+
+#ifdef X86_KERNELS
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** AVX2 kernel
+
+// Vector version of fastKey() on 4 differences: the mask bit of a lane is cleared
+// when its key must come from getKeyFor()
+__attribute__((target("avx2")))
+static inline int fastKeysAVX2(__m256d d, __m256d scale, __m256d slack0, __m256d nullBound, __m128i *keys) {
+
+    const __m256i expMask = _mm256_set1_epi64x(0x7ff);
+    const __m256i mantMask = _mm256_set1_epi64x(0x000fffffffffffffLL);
+    const __m256i one = _mm256_set1_epi64x(0x3ff0000000000000LL);
+    const __m256i centreMask = _mm256_set1_epi64x(~((1LL << (52 - LOG2_TABLE_BITS)) - 1));
+    const __m256i half = _mm256_set1_epi64x(1LL << (51 - LOG2_TABLE_BITS));
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+
+    __m256i bits = _mm256_castpd_si256(d);
+    __m256i e = _mm256_and_si256(_mm256_srli_epi64(bits, 52), expMask);
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi64(e, _mm256_setzero_si256()), _mm256_cmpeq_epi64(e, expMask));
+
+    __m256i idx = _mm256_and_si256(_mm256_srli_epi64(bits, 52 - LOG2_TABLE_BITS), _mm256_set1_epi64x(LOG2_TABLE_SIZE-1));
+    __m256i mbits = _mm256_or_si256(_mm256_and_si256(bits, mantMask), one);
+    __m256i cbits = _mm256_or_si256(_mm256_and_si256(mbits, centreMask), half);
+
+    __m256d inv = _mm256_i64gather_pd(FAST_LOG2.invCentre, idx, 8);
+    __m256d l2c = _mm256_i64gather_pd(FAST_LOG2.log2Centre, idx, 8);
+
+    __m256d r = _mm256_mul_pd(_mm256_sub_pd(_mm256_castsi256_pd(mbits), _mm256_castsi256_pd(cbits)), inv);
+    __m256d ln = _mm256_sub_pd(_mm256_set1_pd(0.25), _mm256_mul_pd(r, _mm256_set1_pd(0.2)));
+    ln = _mm256_sub_pd(_mm256_set1_pd(1.0/3.0), _mm256_mul_pd(r, ln));
+    ln = _mm256_sub_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(r, ln));
+    ln = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(r, ln));
+    ln = _mm256_mul_pd(r, ln);
+
+    // exponent to double: 2^52 + e has e in its low mantissa bits
+    __m256d ed = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(e, magic)), _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    __m256d l2 = _mm256_add_pd(_mm256_add_pd(ed, l2c), _mm256_mul_pd(ln, _mm256_set1_pd(INV_LN2)));
+
+    __m256d x = _mm256_mul_pd(l2, scale);
+    __m256d ax = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    __m256d slack = _mm256_add_pd(_mm256_mul_pd(ax, _mm256_set1_pd(KEY_SLACK)), slack0);
+
+    __m256d kLo = _mm256_ceil_pd(_mm256_sub_pd(x, slack));
+    __m256d kHi = _mm256_ceil_pd(_mm256_add_pd(x, slack));
+
+    __m256d ok = _mm256_cmp_pd(kLo, kHi, _CMP_EQ_OQ);
+    ok = _mm256_and_pd(ok, _mm256_cmp_pd(ax, _mm256_set1_pd(1 << 30), _CMP_LT_OQ));
+    ok = _mm256_and_pd(ok, _mm256_cmp_pd(d, nullBound, _CMP_GT_OQ));
+    ok = _mm256_andnot_pd(_mm256_castsi256_pd(special), ok);
+
+    *keys = _mm256_cvtpd_epi32(_mm256_and_pd(kLo, ok));
+    return _mm256_movemask_pd(ok);
+}
+
+
+// _mm_shuffle_epi8 controls packing the selected 32-bit lanes to the front
+static const struct CompressTable {
+    unsigned char control[16][16];
+
+    CompressTable() {
+        for (int mask = 0; mask < 16; ++mask) {
+            int n = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    for (int b = 0; b < 4; ++b) {
+                        control[mask][4*n + b] = 4*lane + b;
+                    }
+                    ++n;
+                }
+            }//for lane
+            for (int b = 4*n; b < 16; ++b) {
+                control[mask][b] = 0x80;
+            }
+        }//for mask
+    }
+} COMPRESS4;
+
+
+template <class T>
+__attribute__((target("avx2")))
+static inline void fixKeys4(const T *w, int ok, T new_item, T old_item, double gamma, double logG, __m128i *kA, __m128i *kR) {
+
+    int a[4], r[4];
+    _mm_storeu_si128((__m128i *)a, *kA);
+    _mm_storeu_si128((__m128i *)r, *kR);
+    fallbackKeys(w, 4, ok, new_item, old_item, gamma, logG, a, r);
+    *kA = _mm_loadu_si128((__m128i *)a);
+    *kR = _mm_loadu_si128((__m128i *)r);
+}
+
+
+// Packs the lanes whose keys differ at the front of keysA/keysR, returns their number
+__attribute__((target("avx2")))
+static inline int storeChanged4(__m128i kA, __m128i kR, int *keysA, int *keysR) {
+
+    int changed = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(kA, kR))) & 0xF;
+    __m128i control = _mm_loadu_si128((const __m128i *)COMPRESS4.control[changed]);
+    _mm_storeu_si128((__m128i *)keysA, _mm_shuffle_epi8(kA, control));
+    _mm_storeu_si128((__m128i *)keysR, _mm_shuffle_epi8(kR, control));
+    return __builtin_popcount(changed);
+}
+
+
+__attribute__((target("avx2")))
+static int avx2KeyDeltas(const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    double s = LOG10_2/logG;
+    __m256d scale = _mm256_set1_pd(s);
+    __m256d slack0 = _mm256_set1_pd(KEY_SLACK*4.0*s);
+    __m256d nullBound = _mm256_set1_pd(NULLBOUND);
+    __m256d vnew = _mm256_set1_pd(new_item);
+    __m256d vold = _mm256_set1_pd(old_item);
+    __m256d sign = _mm256_set1_pd(-0.0);
+
+    int n = 0;
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+
+        __m256d w = _mm256_loadu_pd(&window[j]);
+        __m256d dA = _mm256_andnot_pd(sign, _mm256_sub_pd(w, vnew));
+        __m256d dR = _mm256_andnot_pd(sign, _mm256_sub_pd(w, vold));
+
+        __m128i kA, kR;
+        int ok = fastKeysAVX2(dA, scale, slack0, nullBound, &kA) & fastKeysAVX2(dR, scale, slack0, nullBound, &kR);
+
+        if (ok != 0xF) {
+            fixKeys4(&window[j], ok, new_item, old_item, gamma, logG, &kA, &kR);
+        }
+        n += storeChanged4(kA, kR, &keysA[n], &keysR[n]);
+    }//for
+
+    return n + scalarKeyDeltas(window, j, to, new_item, old_item, gamma, logG, &keysA[n], &keysR[n]);
+}
+
+
+// getLinearKey() on 4 differences: integer arithmetic on their bit patterns, then the
+// low halves of the 64-bit keys packed to the first 4 lanes
+__attribute__((target("avx2")))
+static inline __m128i linearKeysAVX2(__m256d d, __m256d nullBound, __m128i shift) {
+
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i bits = _mm256_castpd_si256(d);
+    __m256i keys = _mm256_add_epi64(_mm256_srl_epi64(_mm256_sub_epi64(bits, one), shift), one);
+    keys = _mm256_blendv_epi8(keys, _mm256_set1_epi64x(-MIN_KEY), _mm256_castpd_si256(_mm256_cmp_pd(d, nullBound, _CMP_LE_OQ)));
+
+    keys = _mm256_permutevar8x32_epi32(keys, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+    return _mm256_castsi256_si128(keys);
+}
+
+
+__attribute__((target("avx2")))
+static int avx2LinearKeyDeltas(const double *window, int from, int to, double new_item, double old_item, int shift, int *keysA, int *keysR) {
+
+    __m256d nullBound = _mm256_set1_pd(NULLBOUND);
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+    __m256d vnew = _mm256_set1_pd(new_item);
+    __m256d vold = _mm256_set1_pd(old_item);
+    __m256d sign = _mm256_set1_pd(-0.0);
+
+    int n = 0;
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+
+        __m256d w = _mm256_loadu_pd(&window[j]);
+        __m128i kA = linearKeysAVX2(_mm256_andnot_pd(sign, _mm256_sub_pd(w, vnew)), nullBound, vshift);
+        __m128i kR = linearKeysAVX2(_mm256_andnot_pd(sign, _mm256_sub_pd(w, vold)), nullBound, vshift);
+
+        n += storeChanged4(kA, kR, &keysA[n], &keysR[n]);
+    }//for
+
+    return n + scalarLinearKeyDeltas(window, j, to, new_item, old_item, shift, &keysA[n], &keysR[n]);
+}
+
+
+// The float differences are widened to double, exactly, before taking their bits
+__attribute__((target("avx2")))
+static int avx2LinearKeyDeltas(const float *window, int from, int to, float new_item, float old_item, int shift, int *keysA, int *keysR) {
+
+    __m256d nullBound = _mm256_set1_pd(NULLBOUND);
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+    __m128 vnew = _mm_set1_ps(new_item);
+    __m128 vold = _mm_set1_ps(old_item);
+    __m128 sign = _mm_set1_ps(-0.0f);
+
+    int n = 0;
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+
+        __m128 w = _mm_loadu_ps(&window[j]);
+        __m256d dA = _mm256_cvtps_pd(_mm_andnot_ps(sign, _mm_sub_ps(w, vnew)));
+        __m256d dR = _mm256_cvtps_pd(_mm_andnot_ps(sign, _mm_sub_ps(w, vold)));
+
+        n += storeChanged4(linearKeysAVX2(dA, nullBound, vshift), linearKeysAVX2(dR, nullBound, vshift), &keysA[n], &keysR[n]);
+    }//for
+
+    return n + scalarLinearKeyDeltas(window, j, to, new_item, old_item, shift, &keysA[n], &keysR[n]);
+}
+
+
+// Single precision fastKeysAVX2() on 8 float differences, with the wider KEY_SLACK_F
+// band: a float kernel computes twice the keys per instruction
+__attribute__((target("avx2")))
+static inline int fastKeysAVX2(__m256 d, __m256 scale, __m256 slack0, __m256 nullBound, __m256i *keys) {
+
+    const __m256i expMask = _mm256_set1_epi32(0xff);
+    const __m256i mantMask = _mm256_set1_epi32(0x007fffff);
+    const __m256i one = _mm256_set1_epi32(0x3f800000);
+    const __m256i centreMask = _mm256_set1_epi32(~((1 << (23 - LOG2_TABLE_BITS)) - 1));
+    const __m256i half = _mm256_set1_epi32(1 << (22 - LOG2_TABLE_BITS));
+
+    __m256i bits = _mm256_castps_si256(d);
+    __m256i e = _mm256_and_si256(_mm256_srli_epi32(bits, 23), expMask);
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi32(e, _mm256_setzero_si256()), _mm256_cmpeq_epi32(e, expMask));
+
+    __m256i idx = _mm256_and_si256(_mm256_srli_epi32(bits, 23 - LOG2_TABLE_BITS), _mm256_set1_epi32(LOG2_TABLE_SIZE-1));
+    __m256i mbits = _mm256_or_si256(_mm256_and_si256(bits, mantMask), one);
+    __m256i cbits = _mm256_or_si256(_mm256_and_si256(mbits, centreMask), half);
+
+    __m256 inv = _mm256_i32gather_ps(FAST_LOG2.invCentreF, idx, 4);
+    __m256 l2c = _mm256_i32gather_ps(FAST_LOG2.log2CentreF, idx, 4);
+
+    // |r| <= 2^-9: the cubic term is the last one above float precision
+    __m256 r = _mm256_mul_ps(_mm256_sub_ps(_mm256_castsi256_ps(mbits), _mm256_castsi256_ps(cbits)), inv);
+    __m256 ln = _mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(r, _mm256_set1_ps(1.0f/3.0f)));
+    ln = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r, ln));
+    ln = _mm256_mul_ps(r, ln);
+
+    __m256 ef = _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(127)));
+    __m256 l2 = _mm256_add_ps(_mm256_add_ps(ef, l2c), _mm256_mul_ps(ln, _mm256_set1_ps((float)INV_LN2)));
+
+    __m256 x = _mm256_mul_ps(l2, scale);
+    __m256 ax = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+    __m256 slack = _mm256_add_ps(_mm256_mul_ps(ax, _mm256_set1_ps(KEY_SLACK_F)), slack0);
+
+    __m256 kLo = _mm256_ceil_ps(_mm256_sub_ps(x, slack));
+    __m256 kHi = _mm256_ceil_ps(_mm256_add_ps(x, slack));
+
+    // past 2^22 a float no longer tells consecutive keys apart
+    __m256 ok = _mm256_cmp_ps(kLo, kHi, _CMP_EQ_OQ);
+    ok = _mm256_and_ps(ok, _mm256_cmp_ps(ax, _mm256_set1_ps((float)(1 << 22)), _CMP_LT_OQ));
+    ok = _mm256_and_ps(ok, _mm256_cmp_ps(d, nullBound, _CMP_GT_OQ));
+    ok = _mm256_andnot_ps(_mm256_castsi256_ps(special), ok);
+
+    *keys = _mm256_cvtps_epi32(_mm256_and_ps(kLo, ok));
+    return _mm256_movemask_ps(ok);
+}
+
+
+// NULLBOUND rounded up to a float: lanes not above it take the reference path
+static inline float floatNullBound() {
+    float nb = (float)NULLBOUND;
+    return std::nextafter(nb, INFINITY);
+}
+
+
+__attribute__((target("avx2")))
+static int avx2KeyDeltas(const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    float s = (float)(LOG10_2/logG);
+    __m256 scale = _mm256_set1_ps(s);
+    __m256 slack0 = _mm256_set1_ps(KEY_SLACK_F*4.0f*s);
+    __m256 nullBound = _mm256_set1_ps(floatNullBound());
+    __m256 vnew = _mm256_set1_ps(new_item);
+    __m256 vold = _mm256_set1_ps(old_item);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+
+    int n = 0;
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+
+        __m256 w = _mm256_loadu_ps(&window[j]);
+        __m256 dA = _mm256_andnot_ps(sign, _mm256_sub_ps(w, vnew));
+        __m256 dR = _mm256_andnot_ps(sign, _mm256_sub_ps(w, vold));
+
+        __m256i kA, kR;
+        int ok = fastKeysAVX2(dA, scale, slack0, nullBound, &kA) & fastKeysAVX2(dR, scale, slack0, nullBound, &kR);
+
+        if (ok != 0xFF) {
+            int a[8], r[8];
+            _mm256_storeu_si256((__m256i *)a, kA);
+            _mm256_storeu_si256((__m256i *)r, kR);
+            fallbackKeys(&window[j], 8, ok, new_item, old_item, gamma, logG, a, r);
+            kA = _mm256_loadu_si256((__m256i *)a);
+            kR = _mm256_loadu_si256((__m256i *)r);
+        }
+        n += storeChanged4(_mm256_castsi256_si128(kA), _mm256_castsi256_si128(kR), &keysA[n], &keysR[n]);
+        n += storeChanged4(_mm256_extracti128_si256(kA, 1), _mm256_extracti128_si256(kR, 1), &keysA[n], &keysR[n]);
+    }//for
+
+    return n + scalarKeyDeltas(window, j, to, new_item, old_item, gamma, logG, &keysA[n], &keysR[n]);
+}
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** AVX-512 kernel
+
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static inline __mmask8 fastKeysAVX512(__m512d d, __m512d scale, __m512d slack0, __m512d nullBound, __m256i *keys) {
+
+    const __m512i expMask = _mm512_set1_epi64(0x7ff);
+    const __m512i mantMask = _mm512_set1_epi64(0x000fffffffffffffLL);
+    const __m512i one = _mm512_set1_epi64(0x3ff0000000000000LL);
+    const __m512i centreMask = _mm512_set1_epi64(~((1LL << (52 - LOG2_TABLE_BITS)) - 1));
+    const __m512i half = _mm512_set1_epi64(1LL << (51 - LOG2_TABLE_BITS));
+
+    __m512i bits = _mm512_castpd_si512(d);
+    __m512i e = _mm512_and_si512(_mm512_srli_epi64(bits, 52), expMask);
+    __mmask8 ok = _mm512_cmpneq_epi64_mask(e, _mm512_setzero_si512()) & _mm512_cmpneq_epi64_mask(e, expMask);
+
+    __m512i idx = _mm512_and_si512(_mm512_srli_epi64(bits, 52 - LOG2_TABLE_BITS), _mm512_set1_epi64(LOG2_TABLE_SIZE-1));
+    __m512i mbits = _mm512_or_si512(_mm512_and_si512(bits, mantMask), one);
+    __m512i cbits = _mm512_or_si512(_mm512_and_si512(mbits, centreMask), half);
+
+    __m512d inv = _mm512_i64gather_pd(idx, FAST_LOG2.invCentre, 8);
+    __m512d l2c = _mm512_i64gather_pd(idx, FAST_LOG2.log2Centre, 8);
+
+    __m512d r = _mm512_mul_pd(_mm512_sub_pd(_mm512_castsi512_pd(mbits), _mm512_castsi512_pd(cbits)), inv);
+    __m512d ln = _mm512_sub_pd(_mm512_set1_pd(0.25), _mm512_mul_pd(r, _mm512_set1_pd(0.2)));
+    ln = _mm512_sub_pd(_mm512_set1_pd(1.0/3.0), _mm512_mul_pd(r, ln));
+    ln = _mm512_sub_pd(_mm512_set1_pd(0.5), _mm512_mul_pd(r, ln));
+    ln = _mm512_sub_pd(_mm512_set1_pd(1.0), _mm512_mul_pd(r, ln));
+    ln = _mm512_mul_pd(r, ln);
+
+    __m512d ed = _mm512_cvtepi64_pd(_mm512_sub_epi64(e, _mm512_set1_epi64(1023)));
+    __m512d l2 = _mm512_add_pd(_mm512_add_pd(ed, l2c), _mm512_mul_pd(ln, _mm512_set1_pd(INV_LN2)));
+
+    __m512d x = _mm512_mul_pd(l2, scale);
+    __m512d ax = _mm512_abs_pd(x);
+    __m512d slack = _mm512_add_pd(_mm512_mul_pd(ax, _mm512_set1_pd(KEY_SLACK)), slack0);
+
+    __m512d kLo = _mm512_roundscale_pd(_mm512_sub_pd(x, slack), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+    __m512d kHi = _mm512_roundscale_pd(_mm512_add_pd(x, slack), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+
+    ok &= _mm512_cmp_pd_mask(kLo, kHi, _CMP_EQ_OQ);
+    ok &= _mm512_cmp_pd_mask(ax, _mm512_set1_pd(1 << 30), _CMP_LT_OQ);
+    ok &= _mm512_cmp_pd_mask(d, nullBound, _CMP_GT_OQ);
+
+    *keys = _mm512_cvtpd_epi32(_mm512_maskz_mov_pd(ok, kLo));
+    return ok;
+}
+
+
+template <class T>
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static inline void fixKeys8(const T *w, int ok, T new_item, T old_item, double gamma, double logG, __m256i *kA, __m256i *kR) {
+
+    int a[8], r[8];
+    _mm256_storeu_si256((__m256i *)a, *kA);
+    _mm256_storeu_si256((__m256i *)r, *kR);
+    fallbackKeys(w, 8, ok, new_item, old_item, gamma, logG, a, r);
+    *kA = _mm256_loadu_si256((__m256i *)a);
+    *kR = _mm256_loadu_si256((__m256i *)r);
+}
+
+
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static inline int storeChanged8(__m256i kA, __m256i kR, int *keysA, int *keysR) {
+
+    __mmask8 changed = _mm256_cmpneq_epi32_mask(kA, kR);
+    _mm256_mask_compressstoreu_epi32(keysA, changed, kA);
+    _mm256_mask_compressstoreu_epi32(keysR, changed, kR);
+    return __builtin_popcount(changed);
+}
+
+
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static int avx512KeyDeltas(const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    double s = LOG10_2/logG;
+    __m512d scale = _mm512_set1_pd(s);
+    __m512d slack0 = _mm512_set1_pd(KEY_SLACK*4.0*s);
+    __m512d nullBound = _mm512_set1_pd(NULLBOUND);
+    __m512d vnew = _mm512_set1_pd(new_item);
+    __m512d vold = _mm512_set1_pd(old_item);
+
+    int n = 0;
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+
+        __m512d w = _mm512_loadu_pd(&window[j]);
+        __m512d dA = _mm512_abs_pd(_mm512_sub_pd(w, vnew));
+        __m512d dR = _mm512_abs_pd(_mm512_sub_pd(w, vold));
+
+        __m256i kA, kR;
+        __mmask8 ok = fastKeysAVX512(dA, scale, slack0, nullBound, &kA) & fastKeysAVX512(dR, scale, slack0, nullBound, &kR);
+
+        if (ok != 0xFF) {
+            fixKeys8(&window[j], ok, new_item, old_item, gamma, logG, &kA, &kR);
+        }
+        n += storeChanged8(kA, kR, &keysA[n], &keysR[n]);
+    }//for
+
+    return n + scalarKeyDeltas(window, j, to, new_item, old_item, gamma, logG, &keysA[n], &keysR[n]);
+}
+
+
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static inline __mmask16 fastKeysAVX512(__m512 d, __m512 scale, __m512 slack0, __m512 nullBound, __m512i *keys) {
+
+    const __m512i expMask = _mm512_set1_epi32(0xff);
+    const __m512i mantMask = _mm512_set1_epi32(0x007fffff);
+    const __m512i one = _mm512_set1_epi32(0x3f800000);
+    const __m512i centreMask = _mm512_set1_epi32(~((1 << (23 - LOG2_TABLE_BITS)) - 1));
+    const __m512i half = _mm512_set1_epi32(1 << (22 - LOG2_TABLE_BITS));
+
+    __m512i bits = _mm512_castps_si512(d);
+    __m512i e = _mm512_and_si512(_mm512_srli_epi32(bits, 23), expMask);
+    __mmask16 ok = _mm512_cmpneq_epi32_mask(e, _mm512_setzero_si512()) & _mm512_cmpneq_epi32_mask(e, expMask);
+
+    __m512i idx = _mm512_and_si512(_mm512_srli_epi32(bits, 23 - LOG2_TABLE_BITS), _mm512_set1_epi32(LOG2_TABLE_SIZE-1));
+    __m512i mbits = _mm512_or_si512(_mm512_and_si512(bits, mantMask), one);
+    __m512i cbits = _mm512_or_si512(_mm512_and_si512(mbits, centreMask), half);
+
+    __m512 inv = _mm512_i32gather_ps(idx, FAST_LOG2.invCentreF, 4);
+    __m512 l2c = _mm512_i32gather_ps(idx, FAST_LOG2.log2CentreF, 4);
+
+    __m512 r = _mm512_mul_ps(_mm512_sub_ps(_mm512_castsi512_ps(mbits), _mm512_castsi512_ps(cbits)), inv);
+    __m512 ln = _mm512_sub_ps(_mm512_set1_ps(0.5f), _mm512_mul_ps(r, _mm512_set1_ps(1.0f/3.0f)));
+    ln = _mm512_sub_ps(_mm512_set1_ps(1.0f), _mm512_mul_ps(r, ln));
+    ln = _mm512_mul_ps(r, ln);
+
+    __m512 ef = _mm512_cvtepi32_ps(_mm512_sub_epi32(e, _mm512_set1_epi32(127)));
+    __m512 l2 = _mm512_add_ps(_mm512_add_ps(ef, l2c), _mm512_mul_ps(ln, _mm512_set1_ps((float)INV_LN2)));
+
+    __m512 x = _mm512_mul_ps(l2, scale);
+    __m512 ax = _mm512_abs_ps(x);
+    __m512 slack = _mm512_add_ps(_mm512_mul_ps(ax, _mm512_set1_ps(KEY_SLACK_F)), slack0);
+
+    __m512 kLo = _mm512_roundscale_ps(_mm512_sub_ps(x, slack), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+    __m512 kHi = _mm512_roundscale_ps(_mm512_add_ps(x, slack), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+
+    ok &= _mm512_cmp_ps_mask(kLo, kHi, _CMP_EQ_OQ);
+    ok &= _mm512_cmp_ps_mask(ax, _mm512_set1_ps((float)(1 << 22)), _CMP_LT_OQ);
+    ok &= _mm512_cmp_ps_mask(d, nullBound, _CMP_GT_OQ);
+
+    *keys = _mm512_cvtps_epi32(_mm512_maskz_mov_ps(ok, kLo));
+    return ok;
+}
+
+
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+static int avx512KeyDeltas(const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    float s = (float)(LOG10_2/logG);
+    __m512 scale = _mm512_set1_ps(s);
+    __m512 slack0 = _mm512_set1_ps(KEY_SLACK_F*4.0f*s);
+    __m512 nullBound = _mm512_set1_ps(floatNullBound());
+    __m512 vnew = _mm512_set1_ps(new_item);
+    __m512 vold = _mm512_set1_ps(old_item);
+
+    int n = 0;
+    int j = from;
+    for (; j + 16 <= to; j += 16) {
+
+        __m512 w = _mm512_loadu_ps(&window[j]);
+        __m512 dA = _mm512_abs_ps(_mm512_sub_ps(w, vnew));
+        __m512 dR = _mm512_abs_ps(_mm512_sub_ps(w, vold));
+
+        __m512i kA, kR;
+        __mmask16 ok = fastKeysAVX512(dA, scale, slack0, nullBound, &kA) & fastKeysAVX512(dR, scale, slack0, nullBound, &kR);
+
+        if (ok != 0xFFFF) {
+            int a[16], r[16];
+            _mm512_storeu_si512(a, kA);
+            _mm512_storeu_si512(r, kR);
+            fallbackKeys(&window[j], 16, ok, new_item, old_item, gamma, logG, a, r);
+            kA = _mm512_loadu_si512(a);
+            kR = _mm512_loadu_si512(r);
+        }
+
+        __mmask16 changed = _mm512_cmpneq_epi32_mask(kA, kR);
+        _mm512_mask_compressstoreu_epi32(&keysA[n], changed, kA);
+        _mm512_mask_compressstoreu_epi32(&keysR[n], changed, kR);
+        n += __builtin_popcount(changed);
+    }//for
+
+    return n + scalarKeyDeltas(window, j, to, new_item, old_item, gamma, logG, &keysA[n], &keysR[n]);
+}
+
+#endif //X86_KERNELS
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Entry points
+
+int computeKeyDeltasWith(KernelLevel level, const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    #ifdef X86_KERNELS
+        if (level == AVX512_KERNEL) {
+            return avx512KeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+        }
+        if (level == AVX2_KERNEL) {
+            return avx2KeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+        }
+    #endif
+    return scalarKeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+}
+
+
+int computeKeyDeltasWith(KernelLevel level, const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    #ifdef X86_KERNELS
+        if (level == AVX512_KERNEL) {
+            return avx512KeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+        }
+        if (level == AVX2_KERNEL) {
+            return avx2KeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+        }
+    #endif
+    return scalarKeyDeltas(window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+}
+
+
+int computeKeyDeltas(const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    static const KernelLevel level = getKernelLevel();
+    return computeKeyDeltasWith(level, window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+}
+
+
+int computeKeyDeltas(const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    static const KernelLevel level = getKernelLevel();
+    return computeKeyDeltasWith(level, window, from, to, new_item, old_item, gamma, logG, keysA, keysR);
+}
+
+
+// Blocks of differences all below the table size take their keys from it, the others are
+// computed by the double kernel: integers below 2^31 and their differences are exact there
+int computeKeyDeltas(const int *window, int from, int to, int new_item, int old_item, double gamma, double logG, int *keysA, int *keysR) {
+
+    const IntKeyTable& table = getIntKeyTable(gamma, logG);
+    int n = 0;
+
+    for (int j = from; j < to; j += INT_KERNEL_BLOCK) {
+
+        int end = std::min(j + INT_KERNEL_BLOCK, to);
+
+        uint32_t bits = 0;
+        for (int k = j; k < end; ++k) {
+            bits |= intDiff(window[k], new_item) | intDiff(window[k], old_item);
+        }//for k
+
+        if (bits < (uint32_t)INT_KEY_TABLE_SIZE) {
+            for (int k = j; k < end; ++k) {
+                int keyA = table.keys[intDiff(window[k], new_item)];
+                int keyR = table.keys[intDiff(window[k], old_item)];
+
+                keysA[n] = keyA;
+                keysR[n] = keyR;
+                n += (keyA != keyR);
+            }//for k
+        } else {
+            double block[INT_KERNEL_BLOCK];
+            for (int k = j; k < end; ++k) {
+                block[k - j] = window[k];
+            }//for k
+            n += computeKeyDeltas(block, 0, end - j, (double)new_item, (double)old_item, gamma, logG, &keysA[n], &keysR[n]);
+        }//fi
+    }//for j
+
+    return n;
+}
+
+
+// The log-linear keys need no more than AVX2: the 64-bit shifts are the whole computation
+int computeLinearKeyDeltas(const double *window, int from, int to, double new_item, double old_item, int shift, int *keysA, int *keysR) {
+
+    #ifdef X86_KERNELS
+        static const KernelLevel level = getKernelLevel();
+        if (level != SCALAR_KERNEL) {
+            return avx2LinearKeyDeltas(window, from, to, new_item, old_item, shift, keysA, keysR);
+        }
+    #endif
+    return scalarLinearKeyDeltas(window, from, to, new_item, old_item, shift, keysA, keysR);
+}
+
+
+int computeLinearKeyDeltas(const float *window, int from, int to, float new_item, float old_item, int shift, int *keysA, int *keysR) {
+
+    #ifdef X86_KERNELS
+        static const KernelLevel level = getKernelLevel();
+        if (level != SCALAR_KERNEL) {
+            return avx2LinearKeyDeltas(window, from, to, new_item, old_item, shift, keysA, keysR);
+        }
+    #endif
+    return scalarLinearKeyDeltas(window, from, to, new_item, old_item, shift, keysA, keysR);
+}
+
+
+int computeLinearKeyDeltas(const int *window, int from, int to, int new_item, int old_item, int shift, int *keysA, int *keysR) {
+    return scalarLinearKeyDeltas(window, from, to, new_item, old_item, shift, keysA, keysR);
+}
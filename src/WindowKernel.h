@@ -0,0 +1,61 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __WINDOWKERNEL_H__
+#define __WINDOWKERNEL_H__
+
+
+const int KERNEL_CHUNK = 256;       // window elements handled per kernel call
+const int KERNEL_PAD = 8;           // compressed stores may write up to a vector past the last pair
+const int INT_KERNEL_BLOCK = 16;    // integer differences checked against the key table together
+
+typedef enum KernelLevel {
+    SCALAR_KERNEL = 0,
+    AVX2_KERNEL = 1,
+    AVX512_KERNEL = 2
+} KernelLevel;
+
+
+KernelLevel getKernelLevel();
+
+const char *getKernelName(KernelLevel level);
+
+
+// For every w in window[from..to) computes the keys of |w-new_item| and |w-old_item|
+// and stores in keysA/keysR only the pairs whose keys differ; returns their number.
+// keysA and keysR must hold (to-from) + KERNEL_PAD ints.
+int computeKeyDeltas(const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR);
+
+int computeKeyDeltasWith(KernelLevel level, const double *window, int from, int to, double new_item, double old_item, double gamma, double logG, int *keysA, int *keysR);
+
+// Single precision window: the differences are float, their keys those of getKeyFor() on them
+int computeKeyDeltas(const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR);
+
+int computeKeyDeltasWith(KernelLevel level, const float *window, int from, int to, float new_item, float old_item, double gamma, double logG, int *keysA, int *keysR);
+
+// Integer window: exact differences, keyed by the IntKeyTable when they fit it
+int computeKeyDeltas(const int *window, int from, int to, int new_item, int old_item, double gamma, double logG, int *keysA, int *keysR);
+
+// Same deltas for the log-linear keys of a LogLinearSketch, whose bit patterns are shifted right by shift
+int computeLinearKeyDeltas(const double *window, int from, int to, double new_item, double old_item, int shift, int *keysA, int *keysR);
+
+int computeLinearKeyDeltas(const float *window, int from, int to, float new_item, float old_item, int shift, int *keysA, int *keysR);
+
+int computeLinearKeyDeltas(const int *window, int from, int to, int new_item, int old_item, int shift, int *keysA, int *keysR);
+
+
+#endif //__WINDOWKERNEL_H__
@@ -0,0 +1,265 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#include "WindowTeam.h"
+#include "DenseSketch.h"
+#include "FenwickSketch.h"
+#include "SketchPyramid.h"
+#include "LogLinearSketch.h"
+#include "WindowKernel.h"
+
+#include <cstring>
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Team
+
+static void runMember(WindowTeam *team, int member) {
+
+    long seen = 0;
+    for (;;) {
+        int spins = 0;
+        while (team->generation.load(std::memory_order_acquire) == seen) {
+            spinWait(&spins);
+        }//wend
+        ++seen;
+        if (team->stop.load(std::memory_order_relaxed)) {
+            return;
+        }
+        team->job(team, member, team->args);
+        team->pending.fetch_sub(1, std::memory_order_release);
+    }//for jobs
+}
+
+
+// Runs job on every member, the caller as member 0, and returns when all are done
+static void runTeam(WindowTeam *team, TeamJob job, const void *args) {
+
+    team->job = job;
+    team->args = args;
+    team->pending.store(team->threads - 1, std::memory_order_relaxed);
+    team->generation.fetch_add(1, std::memory_order_release);
+
+    job(team, 0, args);
+
+    int spins = 0;
+    while (team->pending.load(std::memory_order_acquire)) {
+        spinWait(&spins);
+    }//wend
+}
+
+
+static inline void clearMember(TeamMember& member) {
+
+    member.base = -MIN_KEY;
+    member.lo = TEAM_DELTA_SPAN;
+    member.hi = -1;
+    member.nullDelta = 0;
+    member.spills = 0;
+}
+
+
+int initWindowTeam(WindowTeam *team, int threads, int s) {
+
+    if (threads < 2) {
+        return 1;
+    }
+
+    team->threads = threads;
+    team->s = s;
+    team->members = (TeamMember *)allocateAligned(threads*sizeof(TeamMember));
+
+    int slice = (s + threads - 1)/threads;
+    for (int t = 0; t < threads; ++t) {
+        TeamMember& member = team->members[t];
+        member.keysA = (int *)allocateAligned((KERNEL_CHUNK + KERNEL_PAD)*sizeof(int));
+        member.keysR = (int *)allocateAligned((KERNEL_CHUNK + KERNEL_PAD)*sizeof(int));
+        member.deltas = (int *)allocateAligned(TEAM_DELTA_SPAN*sizeof(int));
+        memset(member.deltas, 0, TEAM_DELTA_SPAN*sizeof(int));
+        member.spillKeys = (int *)allocateAligned(2*slice*sizeof(int));
+        member.spillDeltas = (int *)allocateAligned(2*slice*sizeof(int));
+        clearMember(member);
+    }//for
+
+    team->generation.store(0);
+    team->pending.store(0);
+    team->stop.store(false);
+    team->workers = new std::thread[threads];
+    for (int t = 1; t < threads; ++t) {
+        team->workers[t] = std::thread(runMember, team, t);
+    }//for
+    return 0;
+}
+
+
+void destroyWindowTeam(WindowTeam *team) {
+
+    team->stop.store(true, std::memory_order_relaxed);
+    team->generation.fetch_add(1, std::memory_order_release);
+    for (int t = 1; t < team->threads; ++t) {
+        team->workers[t].join();
+    }//for
+    delete [] team->workers;
+
+    for (int t = 0; t < team->threads; ++t) {
+        TeamMember& member = team->members[t];
+        free(member.keysA);
+        free(member.keysR);
+        free(member.deltas);
+        free(member.spillKeys);
+        free(member.spillDeltas);
+    }//for
+    free(team->members);
+}
+
+
+
+//****** ****** ****** ****** ****** ************ ************ ************ ************ ****** Window update
+
+template <class SketchT, class T>
+struct TeamArgs {
+    T old_item;
+    T new_item;
+    T *window;
+    int pos;
+    int s;
+    SketchT *Sketch;
+    double gamma;
+    double logGamma;
+};
+
+
+static inline void addDelta(TeamMember& member, int key, int delta) {
+
+    if (key == -MIN_KEY) {
+        member.nullDelta += delta;
+        return;
+    }
+    if (member.base == -MIN_KEY) {
+        member.base = key - TEAM_DELTA_SPAN/2;
+    }
+
+    int idx = key - member.base;
+    if ((unsigned)idx < (unsigned)TEAM_DELTA_SPAN) {
+        member.deltas[idx] += delta;
+        if (idx < member.lo) member.lo = idx;
+        if (idx > member.hi) member.hi = idx;
+    } else {
+        member.spillKeys[member.spills] = key;
+        member.spillDeltas[member.spills] = delta;
+        ++member.spills;
+    }
+}
+
+
+// Keys of the pairs of the new and the old item with the slice of the window of a member
+template <class SketchT, class T>
+static void computeSliceDeltas(WindowTeam *team, int m, const void *args) {
+
+    const TeamArgs<SketchT, T>& item = *(const TeamArgs<SketchT, T> *)args;
+    TeamMember& member = team->members[m];
+
+    int first = (long)item.s*m/team->threads;
+    int last = (long)item.s*(m+1)/team->threads;
+    int ranges[2][2] = { {first, std::min(last, item.pos)}, {std::max(first, item.pos+1), last} };
+
+    for (int r = 0; r < 2; ++r) {
+        for (int from = ranges[r][0]; from < ranges[r][1]; from += KERNEL_CHUNK) {
+
+            int to = std::min(from + KERNEL_CHUNK, ranges[r][1]);
+            int n = getSketchKeyDeltas(*item.Sketch, item.window, from, to, item.new_item, item.old_item, item.gamma, item.logGamma, member.keysA, member.keysR);
+
+            for (int i = 0; i < n; ++i) {
+                addDelta(member, member.keysA[i], 1);
+                addDelta(member, member.keysR[i], -1);
+            }//for i
+        }//for chunk
+    }//for r
+}
+
+
+template <class SketchT>
+static inline void applyDelta(SketchT& Sketch, int key, int delta) {
+
+    if (delta > 0) {
+        incrementBinCount(key, delta, Sketch);
+    } else if (delta < 0 && decreaseBinCount(key, -delta, Sketch) != 1) {
+        std::cerr << "ERROR : key not found in sketch while deleting oldest item"<<std::endl;
+        exit(1);
+    }
+}
+
+
+// Adds the deltas of every member with the sign given to the sketch, and clears them after the negative ones
+template <class SketchT>
+static void reduceDeltas(WindowTeam& team, SketchT& Sketch, int sign) {
+
+    for (int t = 0; t < team.threads; ++t) {
+        TeamMember& member = team.members[t];
+
+        for (int idx = member.lo; idx <= member.hi; ++idx) {
+            int delta = member.deltas[idx];
+            if (delta*sign > 0) {
+                applyDelta(Sketch, member.base + idx, delta);
+            }
+        }//for dense
+        if (member.nullDelta*sign > 0) {
+            applyDelta(Sketch, -MIN_KEY, member.nullDelta);
+        }
+        for (int i = 0; i < member.spills; ++i) {
+            if (member.spillDeltas[i]*sign > 0) {
+                applyDelta(Sketch, member.spillKeys[i], member.spillDeltas[i]);
+            }
+        }//for spilled
+
+        if (sign < 0) {
+            memset(member.deltas + member.lo, 0, std::max(0, member.hi - member.lo + 1)*sizeof(int));
+            clearMember(member);
+        }
+    }//for members
+}
+
+
+template <class SketchT, class T>
+void updateSynopsisTeam(WindowTeam& team, T old_item, T new_item, T *window, int pos, int s, SketchT& Sketch, double gamma, double logGamma) {
+
+    TeamArgs<SketchT, T> args = { old_item, new_item, window, pos, s, &Sketch, gamma, logGamma };
+    runTeam(&team, computeSliceDeltas<SketchT, T>, &args);
+
+    reduceDeltas(team, Sketch, 1);
+    reduceDeltas(team, Sketch, -1);
+}
+
+
+
+#define INSTANTIATE_TEAM_OPS(SketchT, T) \
+    template void updateSynopsisTeam<SketchT, T>(WindowTeam&, T, T, T *, int, int, SketchT&, double, double);
+
+INSTANTIATE_TEAM_OPS(MapSketch, double)
+INSTANTIATE_TEAM_OPS(DenseSketch, double)
+INSTANTIATE_TEAM_OPS(FenwickSketch, double)
+INSTANTIATE_TEAM_OPS(SketchPyramid, double)
+INSTANTIATE_TEAM_OPS(LogLinearSketch, double)
+INSTANTIATE_TEAM_OPS(MapSketch, float)
+INSTANTIATE_TEAM_OPS(DenseSketch, float)
+INSTANTIATE_TEAM_OPS(FenwickSketch, float)
+INSTANTIATE_TEAM_OPS(SketchPyramid, float)
+INSTANTIATE_TEAM_OPS(LogLinearSketch, float)
+INSTANTIATE_TEAM_OPS(MapSketch, int)
+INSTANTIATE_TEAM_OPS(DenseSketch, int)
+INSTANTIATE_TEAM_OPS(FenwickSketch, int)
+INSTANTIATE_TEAM_OPS(SketchPyramid, int)
+INSTANTIATE_TEAM_OPS(LogLinearSketch, int)
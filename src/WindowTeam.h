@@ -0,0 +1,89 @@
+/********************************************************/
+/* AFQN Algorithm                                       */
+/* Approximate Fast Qn in streaming                     */
+/*                                                      */
+/* Coded by Catiuscia Melle                             */
+/*                                                      */
+/* April 8, 2021                                        */
+/*                                                      */
+/* This code accompanies the paper                      */
+/* AFQN: Approximate Qn Estimation in Data Streams      */
+/*                                                      */
+/* By: I. Epicoco, C. Melle, M. Cafaro and  M. Pulimeno */
+/*                                                      */
+/********************************************************/
+
+
+
+#ifndef __WINDOWTEAM_H__
+#define __WINDOWTEAM_H__
+
+#include "DDSketch.h"
+#include "Utility.h"
+
+#include <atomic>
+#include <thread>
+
+const int TEAM_DELTA_SPAN = 1 << 14;    // keys a member counts densely, around the first it meets
+
+
+// -w threads: the full update of an item split over a team of threads (see WindowTeam)
+typedef struct TeamUpdate {
+    static const char *name() { return "full, split over threads"; }
+} TeamUpdate;
+
+
+struct WindowTeam;
+
+typedef void (*TeamJob)(struct WindowTeam *team, int member, const void *args);
+
+
+// Private state of a member, on cache lines of its own: the net change of the count of
+// every key its slice of the window adds or removes, dense over TEAM_DELTA_SPAN keys from
+// base, with the null differences and the keys out of the span on the side
+typedef struct TeamMember {
+    int *keysA;
+    int *keysR;
+    int *deltas;
+    int base;
+    int lo;                 // deltas[lo..hi] may be non zero
+    int hi;
+    BinCount nullDelta;
+    int *spillKeys;
+    int *spillDeltas;
+    int spills;
+    char pad[MEMORY_ALIGNMENT];
+} TeamMember;
+
+
+// Threads that run a job together on every item, the caller being member 0: the others
+// spin on a generation count between items, so that starting and joining a job costs
+// a few cache line transfers rather than a wake-up.
+typedef struct WindowTeam {
+    int threads;
+    int s;
+    std::thread *workers;
+    TeamMember *members;
+
+    TeamJob job;
+    const void *args;
+    std::atomic<long> generation;
+    std::atomic<int> pending;
+    std::atomic<bool> stop;
+} WindowTeam;
+
+
+
+// Team of threads for windows of s items; returns 0, or 1 if threads < 2
+int initWindowTeam(WindowTeam *team, int threads, int s);
+
+void destroyWindowTeam(WindowTeam *team);
+
+// window[pos] = new_item has replaced old_item: same sketch update as updateSynopsisRing(),
+// each member computing the keys of its slice of the window into its deltas, which the
+// caller then adds to the sketch, increments first
+template <class SketchT, class T>
+void updateSynopsisTeam(WindowTeam& team, T old_item, T new_item, T *window, int pos, int s, SketchT& Sketch, double gamma, double logGamma);
+
+
+#endif //__WINDOWTEAM_H__